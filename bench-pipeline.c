@@ -0,0 +1,305 @@
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include "totem-mock-source.h"
+#include "totem-series-summary.h"
+
+/* Runs N synthetic videos through TotemSeriesSummary, from file name
+ * parsing to the episode rows, against mock grilo sources and a local
+ * HTTP server for posters. Reports the throughput, the latency of each
+ * stage and the peak RSS.
+ * Usage: bench-pipeline [OPTION...] [VIDEOS] [EPISODES_PER_SHOW]
+ * No display is needed with GDK_BACKEND=broadway, see `make bench`. */
+
+#define DEFAULT_VIDEOS      1000
+#define MIN_VIDEOS          100
+#define MAX_VIDEOS          100000
+#define DEFAULT_PER_SHOW    500
+#define EPISODES_PER_SEASON 20
+#define STALL_TIMEOUT       10
+#define POSTER_WIDTH        680
+#define POSTER_HEIGHT       1000
+
+static gchar *fixtures = NULL;
+static gint latency = 0;
+static gint jitter = 0;
+static gdouble error_rate = 0;
+static gint rate_limit = 0;
+static gint poster_latency = 0;
+
+static GOptionEntry entries[] = {
+    { "fixtures", 'f', 0, G_OPTION_ARG_FILENAME, &fixtures, "Answer from the fixtures in DIR", "DIR" },
+    { "latency", 'l', 0, G_OPTION_ARG_INT, &latency, "Latency of the sources", "MS" },
+    { "jitter", 'j', 0, G_OPTION_ARG_INT, &jitter, "Jitter of the latency", "MS" },
+    { "error-rate", 'e', 0, G_OPTION_ARG_DOUBLE, &error_rate, "Fraction of failed requests", "RATE" },
+    { "rate-limit", 'r', 0, G_OPTION_ARG_INT, &rate_limit, "Requests per second of each source", "N" },
+    { "poster-latency", 'p', 0, G_OPTION_ARG_INT, &poster_latency, "Latency of the poster server", "MS" },
+    { NULL }
+};
+
+static const gchar *stage_names[TOTEM_SERIES_SUMMARY_N_STAGES] = {
+    "hash", "parse", "resolve", "poster", "view"
+};
+
+typedef struct {
+    GArray    *latencies[TOTEM_SERIES_SUMMARY_N_STAGES];
+    guint      expected;
+    guint      shown;
+    guint      last_shown;
+    gdouble    last_shown_time;
+    GTimer    *timer;
+    GMainLoop *loop;
+} Bench;
+
+static void
+stage_finished_cb (TotemSeriesSummary      *summary,
+                   GrlMedia                *video,
+                   TotemSeriesSummaryStage  stage,
+                   gint64                   elapsed,
+                   Bench                   *bench)
+{
+    g_array_append_val (bench->latencies[stage], elapsed);
+
+    if (stage != TOTEM_SERIES_SUMMARY_STAGE_VIEW)
+      return;
+
+    bench->last_shown_time = g_timer_elapsed (bench->timer, NULL);
+    if (++bench->shown == bench->expected)
+      g_main_loop_quit (bench->loop);
+}
+
+static gboolean
+check_stall (gpointer user_data)
+{
+    Bench *bench = user_data;
+
+    if (bench->shown == bench->last_shown) {
+      g_printerr ("No progress for %d s, giving up\n", STALL_TIMEOUT);
+      g_main_loop_quit (bench->loop);
+      return G_SOURCE_REMOVE;
+    }
+    bench->last_shown = bench->shown;
+    return G_SOURCE_CONTINUE;
+}
+
+static gint
+compare_int64 (gconstpointer a,
+               gconstpointer b)
+{
+    gint64 x = *(const gint64 *) a;
+    gint64 y = *(const gint64 *) b;
+
+    return (x > y) - (x < y);
+}
+
+static gdouble
+percentile_ms (GArray *sorted,
+               guint   p)
+{
+    return g_array_index (sorted, gint64, (sorted->len - 1) * p / 100) / 1000.0;
+}
+
+static void
+register_string_key (const gchar *name)
+{
+    GrlRegistry *registry = grl_registry_get_default ();
+    GParamSpec *spec;
+
+    if (grl_registry_lookup_metadata_key (registry, name) != GRL_METADATA_KEY_INVALID)
+      return;
+
+    spec = g_param_spec_string (name, name, name, NULL,
+                                G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE);
+    grl_registry_register_metadata_key (registry, spec, GRL_METADATA_KEY_INVALID, NULL);
+}
+
+/* One poster per show, served by the mock HTTP server */
+static void
+generate_posters (const gchar *directory,
+                  guint        n_shows)
+{
+    GdkPixbuf *pixbuf;
+    guint i;
+
+    pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, FALSE, 8, POSTER_WIDTH, POSTER_HEIGHT);
+    for (i = 0; i < n_shows; i++) {
+      GError *error = NULL;
+      gchar *name, *path;
+
+      gdk_pixbuf_fill (pixbuf, 0x204080ff + (i << 8));
+      name = g_strdup_printf ("Bench Show %u.jpg", i);
+      path = g_build_filename (directory, name, NULL);
+      gdk_pixbuf_save (pixbuf, path, "jpeg", &error, NULL);
+      g_assert_no_error (error);
+      g_free (path);
+      g_free (name);
+    }
+    g_object_unref (pixbuf);
+}
+
+static TotemMockSource *
+register_mock_source (const gchar *source_id,
+                      const gchar *poster_url)
+{
+    TotemMockSource *source;
+    GError *error = NULL;
+
+    source = totem_mock_source_register (source_id, &error);
+    g_assert_no_error (error);
+    if (fixtures != NULL) {
+      totem_mock_source_set_fixtures (source, fixtures, &error);
+      g_assert_no_error (error);
+    }
+    totem_mock_source_set_poster_url (source, poster_url);
+    totem_mock_source_set_latency (source, latency, jitter);
+    totem_mock_source_set_error_rate (source, error_rate);
+    totem_mock_source_set_rate_limit (source, rate_limit);
+    return source;
+}
+
+static GPtrArray *
+generate_library (guint n_videos,
+                  guint per_show)
+{
+    GrlKeyID hash_key;
+    GPtrArray *library;
+    guint i;
+
+    hash_key = grl_registry_lookup_metadata_key (grl_registry_get_default (), "gibest-hash");
+
+    library = g_ptr_array_new_with_free_func (g_object_unref);
+    for (i = 0; i < n_videos; i++) {
+      guint show = i / per_show;
+      guint season = 1 + (i % per_show) / EPISODES_PER_SEASON;
+      guint episode = 1 + (i % per_show) % EPISODES_PER_SEASON;
+      GrlMedia *video;
+      gchar *url, *hash;
+
+      url = g_strdup_printf ("/bench/Bench.Show.%u.S%02uE%02u.720p.mkv", show, season, episode);
+      hash = g_strdup_printf ("%016x", i + 1);
+
+      /* Files do not exist, the hash is given so the cache still works */
+      video = grl_media_video_new ();
+      grl_media_set_url (video, url);
+      grl_data_set_string (GRL_DATA (video), hash_key, hash);
+      grl_media_set_size (video, 1 + i);
+      g_ptr_array_add (library, video);
+
+      g_free (url);
+      g_free (hash);
+    }
+    return library;
+}
+
+gint main(gint argc, gchar *argv[])
+{
+    TotemSeriesSummary *summary;
+    TotemMockSource *tvdb;
+    GSocketService *http;
+    GOptionContext *context;
+    GtkWidget *win;
+    GPtrArray *library;
+    struct rusage usage;
+    GError *error = NULL;
+    Bench bench = { { NULL } };
+    gchar *cache_dir, *poster_dir, *poster_url;
+    gdouble seconds;
+    guint n_videos, per_show, i;
+
+    /* Always a cold start, with caches of its own */
+    cache_dir = g_dir_make_tmp ("bench-pipeline-XXXXXX", &error);
+    g_assert_no_error (error);
+    g_setenv ("XDG_CACHE_HOME", cache_dir, TRUE);
+
+    context = g_option_context_new ("[VIDEOS] [EPISODES_PER_SHOW]");
+    g_option_context_add_main_entries (context, entries, NULL);
+    g_option_context_add_group (context, gtk_get_option_group (TRUE));
+    if (!g_option_context_parse (context, &argc, &argv, &error)) {
+      g_printerr ("%s\n", error->message);
+      return 1;
+    }
+    g_option_context_free (context);
+
+    n_videos = (argc > 1) ? g_ascii_strtoull (argv[1], NULL, 10) : DEFAULT_VIDEOS;
+    per_show = (argc > 2) ? g_ascii_strtoull (argv[2], NULL, 10) : DEFAULT_PER_SHOW;
+    if (n_videos < MIN_VIDEOS || n_videos > MAX_VIDEOS || per_show == 0) {
+      g_printerr ("VIDEOS must be between %d and %d\n", MIN_VIDEOS, MAX_VIDEOS);
+      return 1;
+    }
+
+    grl_init (&argc, &argv);
+
+    /* Fixtures come with their posters */
+    if (fixtures != NULL) {
+      poster_dir = g_strdup (fixtures);
+    } else {
+      poster_dir = g_build_filename (cache_dir, "served", NULL);
+      g_mkdir (poster_dir, 0700);
+      generate_posters (poster_dir, (n_videos + per_show - 1) / per_show);
+    }
+    http = totem_mock_source_start_http_server (poster_dir, poster_latency, &poster_url, &error);
+    g_assert_no_error (error);
+
+    register_string_key ("thetvdb-poster");
+    tvdb = register_mock_source ("grl-thetvdb", poster_url);
+    register_mock_source ("grl-video-title-parsing", poster_url);
+
+    win = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+    summary = totem_series_summary_new ();
+    gtk_container_add (GTK_CONTAINER (win), GTK_WIDGET (summary));
+    gtk_widget_show_all (win);
+
+    for (i = 0; i < TOTEM_SERIES_SUMMARY_N_STAGES; i++)
+      bench.latencies[i] = g_array_new (FALSE, FALSE, sizeof (gint64));
+    bench.loop = g_main_loop_new (NULL, FALSE);
+    g_signal_connect (summary, "stage-finished", G_CALLBACK (stage_finished_cb), &bench);
+
+    library = generate_library (n_videos, per_show);
+
+    bench.timer = g_timer_new ();
+    bench.expected = totem_series_summary_add_videos (summary, library);
+    g_timeout_add_seconds (STALL_TIMEOUT, check_stall, &bench);
+    if (bench.shown < bench.expected)
+      g_main_loop_run (bench.loop);
+
+    /* Failed videos never show up, do not count the wait for them */
+    seconds = bench.last_shown_time;
+
+    getrusage (RUSAGE_SELF, &usage);
+
+    g_print ("videos:     %u shown of %u\n", bench.shown, n_videos);
+    g_print ("time:       %.1f ms\n", seconds * 1000);
+    g_print ("throughput: %.1f videos/s\n", (seconds > 0) ? bench.shown / seconds : 0);
+    g_print ("peak RSS:   %ld KiB\n", usage.ru_maxrss);
+    g_print ("requests:   %u to tvdb, %u failed\n",
+             totem_mock_source_get_resolve_count (tvdb),
+             totem_mock_source_get_error_count (tvdb));
+    g_print ("%-8s %8s %10s %10s %10s\n", "stage", "count", "p50 ms", "p95 ms", "p99 ms");
+    for (i = 0; i < TOTEM_SERIES_SUMMARY_N_STAGES; i++) {
+      GArray *latencies = bench.latencies[i];
+
+      if (latencies->len > 0) {
+        g_array_sort (latencies, compare_int64);
+        g_print ("%-8s %8u %10.2f %10.2f %10.2f\n", stage_names[i], latencies->len,
+                 percentile_ms (latencies, 50),
+                 percentile_ms (latencies, 95),
+                 percentile_ms (latencies, 99));
+      } else {
+        g_print ("%-8s %8u\n", stage_names[i], 0);
+      }
+      g_array_unref (latencies);
+    }
+
+    g_timer_destroy (bench.timer);
+    gtk_widget_destroy (win);
+    g_socket_service_stop (http);
+    g_object_unref (http);
+    g_free (poster_url);
+    g_free (poster_dir);
+    g_ptr_array_unref (library);
+    g_main_loop_unref (bench.loop);
+    g_print ("caches:     %s\n", cache_dir);
+    g_free (cache_dir);
+    return (bench.shown == bench.expected) ? 0 : 1;
+}
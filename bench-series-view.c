@@ -0,0 +1,107 @@
+#include <glib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "totem-series-view.h"
+
+/* Fills a TotemSeriesView with a synthetic show and reports how long it
+ * took, how many episode rows were created and the memory used.
+ * Usage: bench-series-view [EPISODES] [SEASONS] */
+
+#define DEFAULT_EPISODES 5000
+#define DEFAULT_SEASONS  25
+
+static glong
+get_rss_kib (void)
+{
+    glong pages = 0;
+    FILE *f;
+
+    f = fopen ("/proc/self/statm", "r");
+    if (f == NULL)
+      return 0;
+    if (fscanf (f, "%*ld %ld", &pages) != 1)
+      pages = 0;
+    fclose (f);
+    return pages * (sysconf (_SC_PAGESIZE) / 1024);
+}
+
+static void
+count_rows (GtkWidget *widget,
+            gpointer   user_data)
+{
+    guint *rows = user_data;
+    GList *children;
+
+    children = gtk_container_get_children (GTK_CONTAINER (widget));
+    *rows += g_list_length (children);
+    g_list_free (children);
+}
+
+gint main(gint argc, gchar *argv[])
+{
+    TotemSeriesView *view;
+    GtkWidget *win, *episodes;
+    GPtrArray *library;
+    GTimer *timer;
+    glong rss_before, rss_after;
+    guint n_episodes, n_seasons, rows, i;
+
+    gtk_init (&argc, &argv);
+    grl_init (&argc, &argv);
+
+    n_episodes = (argc > 1) ? g_ascii_strtoull (argv[1], NULL, 10) : DEFAULT_EPISODES;
+    n_seasons = (argc > 2) ? g_ascii_strtoull (argv[2], NULL, 10) : DEFAULT_SEASONS;
+    if (n_episodes == 0 || n_seasons == 0)
+      return 1;
+
+    library = g_ptr_array_new_with_free_func (g_object_unref);
+    for (i = 0; i < n_episodes; i++) {
+      GrlMedia *video;
+      gchar *title;
+
+      video = grl_media_video_new ();
+      title = g_strdup_printf ("Episode %u", i);
+      grl_media_set_show (video, "Fixture");
+      grl_media_set_season (video, 1 + i % n_seasons);
+      grl_media_set_episode (video, 1 + i / n_seasons);
+      grl_media_set_episode_title (video, title);
+      grl_media_add_performer (video, "John Smith");
+      grl_media_add_performer (video, "Jane Smith");
+      g_ptr_array_add (library, video);
+      g_free (title);
+    }
+
+    win = gtk_window_new (GTK_WINDOW_TOPLEVEL);
+    view = totem_series_view_new ();
+    gtk_container_add (GTK_CONTAINER (win), GTK_WIDGET (view));
+    gtk_widget_show_all (win);
+    while (gtk_events_pending ())
+      gtk_main_iteration ();
+
+    rss_before = get_rss_kib ();
+    timer = g_timer_new ();
+
+    totem_series_view_add_videos (view, library);
+    while (gtk_events_pending ())
+      gtk_main_iteration ();
+
+    g_timer_stop (timer);
+    rss_after = get_rss_kib ();
+
+    /* The GtkStack holding one GtkListBox per season */
+    rows = 0;
+    episodes = GTK_WIDGET (gtk_widget_get_template_child (GTK_WIDGET (view),
+                                                          TOTEM_TYPE_SERIES_VIEW,
+                                                          "episodes"));
+    gtk_container_foreach (GTK_CONTAINER (episodes), count_rows, &rows);
+
+    g_print ("episodes:     %u in %u seasons\n", n_episodes, n_seasons);
+    g_print ("rows created: %u\n", rows);
+    g_print ("time:         %.1f ms\n", g_timer_elapsed (timer, NULL) * 1000);
+    g_print ("RSS:          %+ld KiB\n", rss_after - rss_before);
+
+    g_timer_destroy (timer);
+    gtk_widget_destroy (win);
+    g_ptr_array_unref (library);
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <glib.h>
+#include <grilo.h>
+#include <string.h>
+#include "totem-title-parser.h"
+
+/* Compares the native file name parser with grl-video-title-parsing.
+ * Usage: bench-title-parser [CORPUS] where CORPUS has one file name per
+ * line, fixtures/filenames.txt by default; a corpus of typical names is
+ * generated if there is none. */
+
+#define LUA_FACTORY_ID         "grl-lua-factory"
+#define VIDEO_TITLE_PARSING_ID "grl-video-title-parsing"
+
+#define DEFAULT_CORPUS        "fixtures/filenames.txt"
+#define GENERATED_CORPUS_SIZE 4000
+#define NATIVE_ROUNDS         50
+
+static const gchar *shows[] = {
+    "Breaking.Bad", "House", "Game.of.Thrones", "The.Wire", "Doctor.Who.2005",
+    "Mad.Men", "The.Sopranos", "Lost", "Fargo", "True.Detective",
+    "Better Call Saul", "The_Office_US", "Parks.and.Recreation", "Twin.Peaks",
+    "Battlestar.Galactica.2003", "Marvels.Agents.of.S.H.I.E.L.D", "Sherlock",
+    "Stranger.Things", "Black-ish", "Mr.Robot"
+};
+
+static const gchar *movies[] = {
+    "Blade.Runner.1982", "Blade.Runner.2049.2017", "2001.A.Space.Odyssey.1968",
+    "Spider-Man.2002", "The.Big.Lebowski.1998", "Mad.Max.Fury.Road.2015",
+    "Alien (1979)", "Heat.1995", "Arrival.2016", "Drive.2011"
+};
+
+static const gchar *tags[] = {
+    "", ".720p.HDTV.x264-LOL", ".1080p.WEB-DL.DD5.1.H.264-NTb", ".HDTV.XviD-FQM",
+    ".PROPER.720p.BluRay.x264", "[eztv]", ".1080p.BluRay.DTS.x264-CtrlHD"
+};
+
+static const gchar *extensions[] = { ".mkv", ".avi", ".mp4" };
+
+static GPtrArray *
+generate_corpus (guint size)
+{
+    GPtrArray *names;
+    guint i;
+
+    names = g_ptr_array_new_with_free_func (g_free);
+    for (i = 0; i < size; i++) {
+      const gchar *tag = tags[i % G_N_ELEMENTS (tags)];
+      const gchar *ext = extensions[i % G_N_ELEMENTS (extensions)];
+      gchar *name;
+
+      switch (i % 4) {
+      case 0:
+        name = g_strdup_printf ("%s.S%02uE%02u%s%s", shows[i % G_N_ELEMENTS (shows)],
+                                1 + i % 9, 1 + i % 23, tag, ext);
+        break;
+      case 1:
+        name = g_strdup_printf ("%s - %ux%02u - Episode Title%s",
+                                shows[i % G_N_ELEMENTS (shows)], 1 + i % 9, 1 + i % 23, ext);
+        break;
+      case 2:
+        name = g_strdup_printf ("%s%s%s", movies[i % G_N_ELEMENTS (movies)], tag, ext);
+        break;
+      default:
+        /* No known pattern, the Lua source has to handle those */
+        name = g_strdup_printf ("%s.Part%u%s", shows[i % G_N_ELEMENTS (shows)], i % 7, ext);
+        break;
+      }
+      g_ptr_array_add (names, name);
+    }
+    return names;
+}
+
+static GPtrArray *
+load_corpus (const gchar *path)
+{
+    GPtrArray *names;
+    gchar *contents, **lines;
+    GError *error = NULL;
+    guint i;
+
+    if (!g_file_get_contents (path, &contents, NULL, &error)) {
+      g_printerr ("Failed to read %s: %s\n", path, error->message);
+      g_error_free (error);
+      return NULL;
+    }
+
+    names = g_ptr_array_new_with_free_func (g_free);
+    lines = g_strsplit (contents, "\n", -1);
+    for (i = 0; lines[i] != NULL; i++) {
+      g_strstrip (lines[i]);
+      if (*lines[i] != '\0')
+        g_ptr_array_add (names, g_strdup (lines[i]));
+    }
+    g_strfreev (lines);
+    g_free (contents);
+    return names;
+}
+
+static gdouble
+bench_native (GPtrArray *names,
+              guint     *matched)
+{
+    GTimer *timer;
+    gdouble elapsed;
+    guint round, i;
+
+    timer = g_timer_new ();
+    for (round = 0; round < NATIVE_ROUNDS; round++) {
+      *matched = 0;
+      for (i = 0; i < names->len; i++) {
+        TotemTitleInfo info;
+
+        if (totem_title_parser_parse (g_ptr_array_index (names, i), &info)) {
+          (*matched)++;
+          totem_title_info_clear (&info);
+        }
+      }
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    return (names->len * (gdouble) NATIVE_ROUNDS) / elapsed;
+}
+
+static gdouble
+bench_lua (GrlSource *source,
+           GPtrArray *names,
+           guint     *matched)
+{
+    GrlOperationOptions *options;
+    GTimer *timer;
+    GList *keys;
+    gdouble elapsed;
+    guint i;
+
+    options = grl_operation_options_new (grl_source_get_caps (source, GRL_OP_RESOLVE));
+    grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                      GRL_METADATA_KEY_EPISODE_TITLE,
+                                      GRL_METADATA_KEY_SHOW,
+                                      GRL_METADATA_KEY_SEASON,
+                                      GRL_METADATA_KEY_EPISODE,
+                                      GRL_METADATA_KEY_INVALID);
+
+    *matched = 0;
+    timer = g_timer_new ();
+    for (i = 0; i < names->len; i++) {
+      const gchar *name = g_ptr_array_index (names, i);
+      GrlMedia *video;
+
+      video = grl_media_video_new ();
+      grl_media_set_url (video, name);
+      grl_media_set_title (video, name);
+      grl_data_set_boolean (GRL_DATA (video), GRL_METADATA_KEY_TITLE_FROM_FILENAME, TRUE);
+      grl_source_resolve_sync (source, video, keys, options, NULL);
+      if (grl_media_get_show (video) != NULL ||
+          g_strcmp0 (grl_media_get_title (video), name) != 0)
+        (*matched)++;
+      g_object_unref (video);
+    }
+    elapsed = g_timer_elapsed (timer, NULL);
+    g_timer_destroy (timer);
+
+    g_list_free (keys);
+    g_object_unref (options);
+
+    return names->len / elapsed;
+}
+
+gint main(gint argc, gchar *argv[])
+{
+    GrlRegistry *registry;
+    GrlSource *source;
+    GPtrArray *names;
+    GError *error = NULL;
+    gdouble native_rate;
+    guint matched;
+
+    grl_init (&argc, &argv);
+
+    if (argc > 1)
+      names = load_corpus (argv[1]);
+    else if (g_file_test (DEFAULT_CORPUS, G_FILE_TEST_IS_REGULAR))
+      names = load_corpus (DEFAULT_CORPUS);
+    else
+      names = generate_corpus (GENERATED_CORPUS_SIZE);
+    if (names == NULL || names->len == 0)
+      return 1;
+
+    g_print ("Corpus: %u file names\n", names->len);
+
+    native_rate = bench_native (names, &matched);
+    g_print ("native:                  %12.0f names/s (%u matched)\n", native_rate, matched);
+
+    registry = grl_registry_get_default ();
+    grl_registry_load_all_plugins (registry, FALSE, NULL);
+    grl_registry_activate_plugin_by_id (registry, LUA_FACTORY_ID, &error);
+    source = grl_registry_lookup_source (registry, VIDEO_TITLE_PARSING_ID);
+    if (error != NULL || source == NULL) {
+      g_print ("grl-video-title-parsing: not available%s%s\n",
+               error ? ": " : "", error ? error->message : "");
+      g_clear_error (&error);
+    } else {
+      gdouble lua_rate = bench_lua (source, names, &matched);
+
+      g_print ("grl-video-title-parsing: %12.0f names/s (%u matched)\n", lua_rate, matched);
+      g_print ("speedup:                 %12.1fx\n", native_rate / lua_rate);
+    }
+
+    g_ptr_array_unref (names);
+    grl_deinit ();
+    return 0;
+}
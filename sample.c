@@ -72,11 +72,31 @@ setup_grilo(void)
   gibest_hash_key = grl_registry_lookup_metadata_key (registry, "gibest-hash");
 }
 
+static void
+directory_added_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  GError *error = NULL;
+  gint n_videos;
+
+  n_videos = totem_series_summary_add_directory_finish (TOTEM_SERIES_SUMMARY (source_object),
+                                                        res, &error);
+  if (n_videos < 0) {
+    g_warning ("Failed to scan library: %s", error->message);
+    g_error_free (error);
+    return;
+  }
+  g_debug ("%d videos in the library", n_videos);
+}
+
+/* Usage: sample [LIBRARY_DIRECTORY] */
 gint main(gint argc, gchar *argv[])
 {
     GtkSettings *gtk_settings;
     TotemSeriesSummary *tss;
     GrlMedia *video;
+    GPtrArray *library;
     GtkWidget *win;
     gint i;
 
@@ -91,15 +111,26 @@ gint main(gint argc, gchar *argv[])
     tss = totem_series_summary_new ();
     g_return_val_if_fail (TOTEM_IS_SERIES_SUMMARY (tss), 1);
 
-    for (i = 0; i < G_N_ELEMENTS (videos); i++) {
-      video = grl_media_video_new();
-      g_debug ("url: %s", videos[i].url);
-      grl_media_set_url (video, videos[i].url);
-      grl_media_set_title (video, videos[i].url);
-      grl_data_set_string (GRL_DATA (video), gibest_hash_key, videos[i].gibest_hash);
-      grl_media_set_size (video, videos[i].file_size);
-      totem_series_summary_add_video (tss, video);
-      g_object_unref (video);
+    if (argc > 1) {
+      GFile *directory = g_file_new_for_commandline_arg (argv[1]);
+
+      /* New and deleted episodes show up while running */
+      totem_series_summary_set_watch (tss, TRUE);
+      totem_series_summary_add_directory_async (tss, directory, NULL, directory_added_cb, NULL);
+      g_object_unref (directory);
+    } else {
+      library = g_ptr_array_new_with_free_func (g_object_unref);
+      for (i = 0; i < G_N_ELEMENTS (videos); i++) {
+        video = grl_media_video_new();
+        g_debug ("url: %s", videos[i].url);
+        grl_media_set_url (video, videos[i].url);
+        grl_media_set_title (video, videos[i].url);
+        grl_data_set_string (GRL_DATA (video), gibest_hash_key, videos[i].gibest_hash);
+        grl_media_set_size (video, videos[i].file_size);
+        g_ptr_array_add (library, video);
+      }
+      totem_series_summary_add_videos (tss, library);
+      g_ptr_array_unref (library);
     }
 
     win = gtk_window_new(GTK_WINDOW_TOPLEVEL);
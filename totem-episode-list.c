@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+/* The episodes of a season as a GListModel for GtkListBox. Episodes stay
+ * plain records sorted in a GSequence; the TotemEpisodeItem wrapping one
+ * is only created when a row asks for it, and dropped with it, so seasons
+ * that are never shown cost no object per episode. */
+
+#include "totem-episode-list.h"
+
+#include <string.h>
+
+typedef struct _TotemEpisodeListPrivate
+{
+  /* Of const TotemEpisode *, owned by the caller's arena */
+  GSequence *index;
+} TotemEpisodeListPrivate;
+
+typedef struct _TotemEpisodeItemPrivate
+{
+  const TotemEpisode *episode;
+} TotemEpisodeItemPrivate;
+
+static void totem_episode_list_model_init (GListModelInterface *iface);
+
+G_DEFINE_TYPE_WITH_CODE (TotemEpisodeList, totem_episode_list, G_TYPE_OBJECT,
+                         G_ADD_PRIVATE (TotemEpisodeList)
+                         G_IMPLEMENT_INTERFACE (G_TYPE_LIST_MODEL, totem_episode_list_model_init));
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemEpisodeItem, totem_episode_item, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+/* By episode number; several files of the same episode, e.g. other
+ * releases or resolutions, are all kept and sorted by url */
+static gint
+compare_episodes (gconstpointer a,
+                  gconstpointer b,
+                  gpointer      user_data)
+{
+  const TotemEpisode *episode_a = a;
+  const TotemEpisode *episode_b = b;
+
+  if (episode_a->episode != episode_b->episode)
+    return (episode_a->episode > episode_b->episode) - (episode_a->episode < episode_b->episode);
+
+  return strcmp (episode_a->url, episode_b->url);
+}
+
+static GType
+totem_episode_list_get_item_type (GListModel *model)
+{
+  return TOTEM_TYPE_EPISODE_ITEM;
+}
+
+static guint
+totem_episode_list_get_n_items (GListModel *model)
+{
+  return g_sequence_get_length (TOTEM_EPISODE_LIST (model)->priv->index);
+}
+
+static gpointer
+totem_episode_list_get_item (GListModel *model,
+                             guint       position)
+{
+  TotemEpisodeList *self = TOTEM_EPISODE_LIST (model);
+  TotemEpisodeItem *item;
+  GSequenceIter *iter;
+
+  iter = g_sequence_get_iter_at_pos (self->priv->index, position);
+  if (g_sequence_iter_is_end (iter))
+    return NULL;
+
+  item = g_object_new (TOTEM_TYPE_EPISODE_ITEM, NULL);
+  item->priv->episode = g_sequence_get (iter);
+  return item;
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+TotemEpisodeList *
+totem_episode_list_new (void)
+{
+  return g_object_new (TOTEM_TYPE_EPISODE_LIST, NULL);
+}
+
+/* Results arrive in any order, @episode is inserted at its place in
+ * O(log n). Returns its position. */
+guint
+totem_episode_list_insert (TotemEpisodeList   *self,
+                           const TotemEpisode *episode)
+{
+  GSequenceIter *iter;
+  guint position;
+
+  g_return_val_if_fail (TOTEM_IS_EPISODE_LIST (self), 0);
+  g_return_val_if_fail (episode != NULL, 0);
+
+  iter = g_sequence_insert_sorted (self->priv->index, (gpointer) episode,
+                                   compare_episodes, NULL);
+  position = g_sequence_iter_get_position (iter);
+  g_list_model_items_changed (G_LIST_MODEL (self), position, 0, 1);
+
+  return position;
+}
+
+gboolean
+totem_episode_list_remove (TotemEpisodeList   *self,
+                           const TotemEpisode *episode)
+{
+  GSequenceIter *iter;
+  guint position;
+
+  g_return_val_if_fail (TOTEM_IS_EPISODE_LIST (self), FALSE);
+  g_return_val_if_fail (episode != NULL, FALSE);
+
+  iter = g_sequence_lookup (self->priv->index, (gpointer) episode, compare_episodes, NULL);
+  if (iter == NULL)
+    return FALSE;
+
+  position = g_sequence_iter_get_position (iter);
+  g_sequence_remove (iter);
+  g_list_model_items_changed (G_LIST_MODEL (self), position, 1, 0);
+
+  return TRUE;
+}
+
+/* @episode is a newer record of the same file as @old_episode, with the
+ * same number. It takes its place without "items-changed": it is the
+ * same item with updated metadata, so the row showing it, and whatever
+ * the user expanded there, stays and is refreshed by the caller. Returns
+ * the position, or -1 if @old_episode is not in the list. */
+gint
+totem_episode_list_replace (TotemEpisodeList   *self,
+                            const TotemEpisode *old_episode,
+                            const TotemEpisode *episode)
+{
+  GSequenceIter *iter;
+
+  g_return_val_if_fail (TOTEM_IS_EPISODE_LIST (self), -1);
+  g_return_val_if_fail (old_episode != NULL && episode != NULL, -1);
+
+  if (compare_episodes (old_episode, episode, NULL) != 0)
+    return -1;
+
+  iter = g_sequence_lookup (self->priv->index, (gpointer) old_episode, compare_episodes, NULL);
+  if (iter == NULL || g_sequence_get (iter) != old_episode)
+    return -1;
+
+  g_sequence_set (iter, (gpointer) episode);
+  return g_sequence_iter_get_position (iter);
+}
+
+/* Position of @episode, or -1 */
+gint
+totem_episode_list_find (TotemEpisodeList   *self,
+                         const TotemEpisode *episode)
+{
+  GSequenceIter *iter;
+
+  g_return_val_if_fail (TOTEM_IS_EPISODE_LIST (self), -1);
+  g_return_val_if_fail (episode != NULL, -1);
+
+  iter = g_sequence_lookup (self->priv->index, (gpointer) episode, compare_episodes, NULL);
+  return (iter != NULL) ? g_sequence_iter_get_position (iter) : -1;
+}
+
+/* As g_list_model_get_item() without creating an item */
+const TotemEpisode *
+totem_episode_list_get_episode (TotemEpisodeList *self,
+                                guint             position)
+{
+  GSequenceIter *iter;
+
+  g_return_val_if_fail (TOTEM_IS_EPISODE_LIST (self), NULL);
+
+  iter = g_sequence_get_iter_at_pos (self->priv->index, position);
+  return g_sequence_iter_is_end (iter) ? NULL : g_sequence_get (iter);
+}
+
+/* The episode is owned by the list's caller and only valid while it is
+ * in the list */
+const TotemEpisode *
+totem_episode_item_get_episode (TotemEpisodeItem *self)
+{
+  g_return_val_if_fail (TOTEM_IS_EPISODE_ITEM (self), NULL);
+
+  return self->priv->episode;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_episode_list_finalize (GObject *object)
+{
+  TotemEpisodeListPrivate *priv = TOTEM_EPISODE_LIST (object)->priv;
+
+  g_clear_pointer (&priv->index, g_sequence_free);
+
+  G_OBJECT_CLASS (totem_episode_list_parent_class)->finalize (object);
+}
+
+static void
+totem_episode_list_model_init (GListModelInterface *iface)
+{
+  iface->get_item_type = totem_episode_list_get_item_type;
+  iface->get_n_items = totem_episode_list_get_n_items;
+  iface->get_item = totem_episode_list_get_item;
+}
+
+static void
+totem_episode_list_init (TotemEpisodeList *self)
+{
+  self->priv = totem_episode_list_get_instance_private (self);
+  self->priv->index = g_sequence_new (NULL);
+}
+
+static void
+totem_episode_list_class_init (TotemEpisodeListClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = totem_episode_list_finalize;
+}
+
+static void
+totem_episode_item_init (TotemEpisodeItem *self)
+{
+  self->priv = totem_episode_item_get_instance_private (self);
+}
+
+static void
+totem_episode_item_class_init (TotemEpisodeItemClass *class)
+{
+}
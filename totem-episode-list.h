@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_EPISODE_LIST_H
+#define TOTEM_EPISODE_LIST_H
+
+#include <gio/gio.h>
+
+#include "totem-episode.h"
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_EPISODE_LIST             (totem_episode_list_get_type())
+
+#define TOTEM_EPISODE_LIST(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_EPISODE_LIST, TotemEpisodeList))
+#define TOTEM_EPISODE_LIST_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_EPISODE_LIST, TotemEpisodeListClass))
+#define TOTEM_IS_EPISODE_LIST(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_EPISODE_LIST))
+#define TOTEM_IS_EPISODE_LIST_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_EPISODE_LIST))
+#define TOTEM_EPISODE_LIST_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_EPISODE_LIST, TotemEpisodeListClass))
+
+#define TOTEM_TYPE_EPISODE_ITEM             (totem_episode_item_get_type())
+
+#define TOTEM_EPISODE_ITEM(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_EPISODE_ITEM, TotemEpisodeItem))
+#define TOTEM_EPISODE_ITEM_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_EPISODE_ITEM, TotemEpisodeItemClass))
+#define TOTEM_IS_EPISODE_ITEM(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_EPISODE_ITEM))
+#define TOTEM_IS_EPISODE_ITEM_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_EPISODE_ITEM))
+#define TOTEM_EPISODE_ITEM_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_EPISODE_ITEM, TotemEpisodeItemClass))
+
+typedef struct _TotemEpisodeList        TotemEpisodeList;
+typedef struct _TotemEpisodeListClass   TotemEpisodeListClass;
+typedef struct _TotemEpisodeListPrivate TotemEpisodeListPrivate;
+
+typedef struct _TotemEpisodeItem        TotemEpisodeItem;
+typedef struct _TotemEpisodeItemClass   TotemEpisodeItemClass;
+typedef struct _TotemEpisodeItemPrivate TotemEpisodeItemPrivate;
+
+struct _TotemEpisodeList
+{
+  GObject parent_instance;
+  TotemEpisodeListPrivate *priv;
+};
+
+struct _TotemEpisodeListClass
+{
+  GObjectClass parent_class;
+};
+
+struct _TotemEpisodeItem
+{
+  GObject parent_instance;
+  TotemEpisodeItemPrivate *priv;
+};
+
+struct _TotemEpisodeItemClass
+{
+  GObjectClass parent_class;
+};
+
+GType               totem_episode_list_get_type           (void) G_GNUC_CONST;
+GType               totem_episode_item_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemEpisodeList *totem_episode_list_new (void);
+guint totem_episode_list_insert (TotemEpisodeList   *self,
+                                 const TotemEpisode *episode);
+gboolean totem_episode_list_remove (TotemEpisodeList   *self,
+                                    const TotemEpisode *episode);
+gint totem_episode_list_replace (TotemEpisodeList   *self,
+                                 const TotemEpisode *old_episode,
+                                 const TotemEpisode *episode);
+gint totem_episode_list_find (TotemEpisodeList   *self,
+                              const TotemEpisode *episode);
+const TotemEpisode *totem_episode_list_get_episode (TotemEpisodeList *self,
+                                                    guint             position);
+
+const TotemEpisode *totem_episode_item_get_episode (TotemEpisodeItem *self);
+
+G_END_DECLS
+
+#endif /* TOTEM_EPISODE_LIST_H */
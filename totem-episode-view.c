@@ -27,7 +27,8 @@
 
 typedef struct _TotemEpisodeViewPrivate
 {
-  GrlMedia *media;
+  /* Owned by the arena of the series view */
+  const TotemEpisode *episode;
 
   GtkLabel *episode_number_label;
   GtkLabel *episode_title_label;
@@ -39,8 +40,19 @@ typedef struct _TotemEpisodeViewPrivate
   GtkButton *watch_now_button;
 
   GtkRevealer *revealer;
+
+  /* Subtitles are only looked up once the user shows interest */
+  gboolean subtitles_requested;
 } TotemEpisodeViewPrivate;
 
+enum {
+  SUBTITLES_NEEDED,
+  SUBTITLE_SELECTED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
 G_DEFINE_TYPE_WITH_PRIVATE (TotemEpisodeView, totem_episode_view, GTK_TYPE_BOX);
 
 /* -------------------------------------------------------------------------- *
@@ -50,19 +62,19 @@ G_DEFINE_TYPE_WITH_PRIVATE (TotemEpisodeView, totem_episode_view, GTK_TYPE_BOX);
 static void
 totem_episode_view_update (TotemEpisodeView *self)
 {
-  GrlMedia *media;
-  gint episode_number;
+  const TotemEpisode *episode;
   gchar *episode_number_string;
   const gchar *episode_title;
 
-  media = self->priv->media;
+  episode = self->priv->episode;
+  if (episode == NULL)
+    return;
 
-  episode_number = grl_media_get_episode (media);
-  episode_number_string = g_strdup_printf ("%d", episode_number);
+  episode_number_string = g_strdup_printf ("%d", episode->episode);
   gtk_label_set_text (self->priv->episode_number_label, episode_number_string);
   g_free (episode_number_string);
 
-  episode_title = grl_media_get_episode_title (media);
+  episode_title = episode->title;
 
   if (episode_title != NULL && g_strcmp0 (episode_title, "") != 0) {
     gtk_label_set_text (self->priv->episode_title_label, episode_title);
@@ -72,6 +84,18 @@ totem_episode_view_update (TotemEpisodeView *self)
   }
 }
 
+static void
+subtitles_combo_changed_cb (GtkComboBox      *combo,
+                            TotemEpisodeView *self)
+{
+  const gchar *language;
+
+  /* Also while the languages are filled in */
+  language = gtk_combo_box_get_active_id (combo);
+  if (language != NULL)
+    g_signal_emit (self, signals[SUBTITLE_SELECTED], 0, language);
+}
+
 /* -------------------------------------------------------------------------- *
  * External
  * -------------------------------------------------------------------------- */
@@ -86,23 +110,78 @@ totem_episode_view_new (void)
   return self;
 }
 
+/* @episode must outlive the view, see TotemEpisodeArena */
 void
-totem_episode_view_set_media (TotemEpisodeView *self,
-                              GrlMedia         *media)
+totem_episode_view_set_episode (TotemEpisodeView   *self,
+                                const TotemEpisode *episode)
 {
-  if (self->priv->media !=NULL) {
-    g_object_unref (self->priv->media);
-    self->priv->media = NULL;
-  }
-
-  if (media != NULL) {
-    g_object_ref (media);
-    self->priv->media = media;
-  }
+  g_return_if_fail (TOTEM_IS_EPISODE_VIEW (self));
 
+  self->priv->episode = episode;
   totem_episode_view_update (self);
 }
 
+const TotemEpisode *
+totem_episode_view_get_episode (TotemEpisodeView *self)
+{
+  g_return_val_if_fail (TOTEM_IS_EPISODE_VIEW (self), NULL);
+
+  return self->priv->episode;
+}
+
+/* Show the details of the episode, which asks for its subtitles */
+void
+totem_episode_view_set_expanded (TotemEpisodeView *self,
+                                 gboolean          expanded)
+{
+  g_return_if_fail (TOTEM_IS_EPISODE_VIEW (self));
+
+  gtk_revealer_set_reveal_child (self->priv->revealer, expanded);
+  if (expanded)
+    totem_episode_view_request_subtitles (self);
+}
+
+gboolean
+totem_episode_view_get_expanded (TotemEpisodeView *self)
+{
+  g_return_val_if_fail (TOTEM_IS_EPISODE_VIEW (self), FALSE);
+
+  return gtk_revealer_get_reveal_child (self->priv->revealer);
+}
+
+/* Emits ::subtitles-needed, only the first time. Called on expand, or once
+ * the pointer rests on it, so that they are usually there once expanded. */
+void
+totem_episode_view_request_subtitles (TotemEpisodeView *self)
+{
+  g_return_if_fail (TOTEM_IS_EPISODE_VIEW (self));
+
+  if (self->priv->subtitles_requested || self->priv->episode == NULL)
+    return;
+
+  self->priv->subtitles_requested = TRUE;
+  g_signal_emit (self, signals[SUBTITLES_NEEDED], 0);
+}
+
+/* Languages the subtitles of the episode are available in; the user
+ * picking one emits ::subtitle-selected */
+void
+totem_episode_view_set_subtitles (TotemEpisodeView    *self,
+                                  const gchar * const *languages)
+{
+  GtkComboBoxText *combo;
+  guint i;
+
+  g_return_if_fail (TOTEM_IS_EPISODE_VIEW (self));
+
+  combo = self->priv->subtitles_combo;
+  gtk_combo_box_text_remove_all (combo);
+  for (i = 0; languages != NULL && languages[i] != NULL; i++)
+    gtk_combo_box_text_append (combo, languages[i], languages[i]);
+
+  gtk_widget_set_sensitive (GTK_WIDGET (combo), i > 0);
+}
+
 /* -------------------------------------------------------------------------- *
  * Object
  * -------------------------------------------------------------------------- */
@@ -119,7 +198,12 @@ totem_episode_view_init (TotemEpisodeView *self)
   gtk_widget_init_template (GTK_WIDGET (self));
   self->priv = totem_episode_view_get_instance_private (self);
 
-  self->priv->media = NULL;
+  self->priv->episode = NULL;
+
+  /* Until the subtitles are looked up */
+  gtk_widget_set_sensitive (GTK_WIDGET (self->priv->subtitles_combo), FALSE);
+  g_signal_connect (self->priv->subtitles_combo, "changed",
+                    G_CALLBACK (subtitles_combo_changed_cb), self);
 }
 
 static void
@@ -130,6 +214,22 @@ totem_episode_view_class_init (TotemEpisodeViewClass *class)
 
   object_class->finalize = totem_episode_view_finalize;
 
+  /* Emitted once, when the subtitles of the episode should be looked up */
+  signals[SUBTITLES_NEEDED] =
+    g_signal_new ("subtitles-needed",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 0);
+
+  /* Emitted with the language of the subtitles the user picked */
+  signals[SUBTITLE_SELECTED] =
+    g_signal_new ("subtitle-selected",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_STRING);
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/totem/grilo/totem-episode-view.ui");
   gtk_widget_class_bind_template_child_private (widget_class, TotemEpisodeView, episode_number_label);
   gtk_widget_class_bind_template_child_private (widget_class, TotemEpisodeView, episode_title_label);
@@ -27,6 +27,8 @@
 #include <grilo.h>
 #include <gtk/gtk.h>
 
+#include "totem-episode.h"
+
 G_BEGIN_DECLS
 
 #define TOTEM_TYPE_EPISODE_VIEW             (totem_episode_view_get_type())
@@ -56,8 +58,15 @@ GType               totem_episode_view_get_type           (void) G_GNUC_CONST;
 
 /* External */
 TotemEpisodeView *totem_episode_view_new (void);
-void totem_episode_view_set_media (TotemEpisodeView *self,
-                                   GrlMedia         *media);
+void totem_episode_view_set_episode (TotemEpisodeView   *self,
+                                     const TotemEpisode *episode);
+const TotemEpisode *totem_episode_view_get_episode (TotemEpisodeView *self);
+void totem_episode_view_set_expanded (TotemEpisodeView *self,
+                                      gboolean          expanded);
+gboolean totem_episode_view_get_expanded (TotemEpisodeView *self);
+void totem_episode_view_request_subtitles (TotemEpisodeView *self);
+void totem_episode_view_set_subtitles (TotemEpisodeView    *self,
+                                       const gchar * const *languages);
 
 G_END_DECLS
 
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+/* Episodes of a series are allocated in blocks and their strings are
+ * shared between them, a few dozen bytes each instead of a GrlMedia with
+ * every key and related keys list grilo returned. A string is freed with
+ * the last episode using it, the blocks at once with the series. */
+
+#include "totem-episode.h"
+
+#define EPISODES_PER_BLOCK 64
+
+struct _TotemEpisodeArena
+{
+  /* String -> number of episodes using it. The strings are freed by hand,
+   * updating the count must not free the key. */
+  GHashTable *strings;
+  GrlKeyID    hash_key;
+
+  /* Of EPISODES_PER_BLOCK episodes, the last one filled up to n_used */
+  GPtrArray *blocks;
+  guint      n_used;
+
+  /* Episodes released, reused before the blocks grow */
+  GPtrArray *released;
+};
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static gint16
+clamp_number (gint number)
+{
+  return (gint16) CLAMP (number, 0, G_MAXINT16);
+}
+
+/* The same strings are stored only once, e.g. when an episode is updated,
+ * so that they keep their address while any episode uses them */
+static const gchar *
+intern_string (TotemEpisodeArena *arena,
+               const gchar       *string)
+{
+  gpointer key, count;
+
+  if (string == NULL)
+    return NULL;
+
+  if (g_hash_table_lookup_extended (arena->strings, string, &key, &count)) {
+    g_hash_table_insert (arena->strings, key, GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+    return key;
+  }
+
+  key = g_strdup (string);
+  g_hash_table_insert (arena->strings, key, GUINT_TO_POINTER (1));
+  return key;
+}
+
+static void
+unintern_string (TotemEpisodeArena *arena,
+                 const gchar       *string)
+{
+  guint count;
+
+  if (string == NULL)
+    return;
+
+  count = GPOINTER_TO_UINT (g_hash_table_lookup (arena->strings, string));
+  g_return_if_fail (count > 0);
+
+  if (count == 1) {
+    g_hash_table_remove (arena->strings, string);
+    g_free ((gchar *) string);
+  } else {
+    g_hash_table_insert (arena->strings, (gpointer) string, GUINT_TO_POINTER (count - 1));
+  }
+}
+
+static TotemEpisode *
+allocate_episode (TotemEpisodeArena *arena)
+{
+  TotemEpisode *block;
+
+  if (arena->released->len > 0)
+    return g_ptr_array_remove_index_fast (arena->released, arena->released->len - 1);
+
+  if (arena->blocks->len == 0 || arena->n_used == EPISODES_PER_BLOCK) {
+    g_ptr_array_add (arena->blocks, g_new (TotemEpisode, EPISODES_PER_BLOCK));
+    arena->n_used = 0;
+  }
+
+  block = g_ptr_array_index (arena->blocks, arena->blocks->len - 1);
+  return &block[arena->n_used++];
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+TotemEpisodeArena *
+totem_episode_arena_new (void)
+{
+  TotemEpisodeArena *arena;
+
+  arena = g_slice_new0 (TotemEpisodeArena);
+  arena->strings = g_hash_table_new (g_str_hash, g_str_equal);
+  arena->blocks = g_ptr_array_new_with_free_func (g_free);
+  arena->released = g_ptr_array_new ();
+  arena->hash_key = grl_registry_lookup_metadata_key (grl_registry_get_default (),
+                                                      "gibest-hash");
+
+  return arena;
+}
+
+void
+totem_episode_arena_free (TotemEpisodeArena *arena)
+{
+  GHashTableIter iter;
+  gchar *string;
+
+  if (arena == NULL)
+    return;
+
+  g_hash_table_iter_init (&iter, arena->strings);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &string, NULL))
+    g_free (string);
+  g_hash_table_unref (arena->strings);
+  g_ptr_array_unref (arena->blocks);
+  g_ptr_array_unref (arena->released);
+  g_slice_free (TotemEpisodeArena, arena);
+}
+
+/* The record of @video, valid until released or until @arena is freed */
+const TotemEpisode *
+totem_episode_arena_add (TotemEpisodeArena *arena,
+                         GrlMedia          *video)
+{
+  TotemEpisode *episode;
+  GDateTime *released;
+  const gchar *title;
+
+  g_return_val_if_fail (arena != NULL, NULL);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), NULL);
+
+  title = grl_media_get_episode_title (video);
+  if (title == NULL || *title == '\0')
+    title = grl_media_get_title (video);
+
+  episode = allocate_episode (arena);
+  episode->url = intern_string (arena, grl_media_get_url (video));
+  episode->title = intern_string (arena, title);
+  episode->poster = intern_string (arena, grl_media_get_thumbnail (video));
+  episode->hash = NULL;
+  if (arena->hash_key != GRL_METADATA_KEY_INVALID)
+    episode->hash = intern_string (arena, grl_data_get_string (GRL_DATA (video), arena->hash_key));
+  episode->size = grl_media_get_size (video);
+  episode->season = clamp_number (grl_media_get_season (video));
+  episode->episode = clamp_number (grl_media_get_episode (video));
+
+  released = grl_media_get_publication_date (video);
+  episode->year = released ? clamp_number (g_date_time_get_year (released)) : 0;
+
+  return episode;
+}
+
+/* The strings of @episode are freed unless other episodes use them; its
+ * record is reused by the next episode added */
+void
+totem_episode_arena_release (TotemEpisodeArena  *arena,
+                             const TotemEpisode *episode)
+{
+  TotemEpisode *record = (TotemEpisode *) episode;
+
+  g_return_if_fail (arena != NULL);
+  g_return_if_fail (episode != NULL);
+
+  unintern_string (arena, record->url);
+  unintern_string (arena, record->title);
+  unintern_string (arena, record->poster);
+  unintern_string (arena, record->hash);
+  record->url = record->title = record->poster = record->hash = NULL;
+
+  g_ptr_array_add (arena->released, record);
+}
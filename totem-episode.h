@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#ifndef TOTEM_EPISODE_H
+#define TOTEM_EPISODE_H
+
+#include <grilo.h>
+
+G_BEGIN_DECLS
+
+/* What the view keeps of an episode once it is shown. Immutable, owned by
+ * the TotemEpisodeArena of its series; the strings are interned there. */
+typedef struct
+{
+  const gchar *url;
+  const gchar *title;     /* Episode title, or else the title of the video */
+  const gchar *poster;    /* Thumbnail url, NULL if none */
+  const gchar *hash;      /* Gibest hash of the file, for subtitles */
+  gint64       size;
+  gint16       season;
+  gint16       episode;
+  gint16       year;      /* Of the release, 0 if unknown */
+} TotemEpisode;
+
+typedef struct _TotemEpisodeArena TotemEpisodeArena;
+
+/* External */
+TotemEpisodeArena *totem_episode_arena_new (void);
+void totem_episode_arena_free (TotemEpisodeArena *arena);
+const TotemEpisode *totem_episode_arena_add (TotemEpisodeArena *arena,
+                                             GrlMedia          *video);
+void totem_episode_arena_release (TotemEpisodeArena  *arena,
+                                  const TotemEpisode *episode);
+
+G_END_DECLS
+
+#endif /* TOTEM_EPISODE_H */
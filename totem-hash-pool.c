@@ -0,0 +1,600 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+/* Computes the gibest hash, also known as OpenSubtitles hash, of video
+ * files in worker threads: the file size plus the sum of the first and
+ * last 64 KiB taken as little endian 64 bits integers. */
+
+#include "totem-hash-pool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib/gstdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE (64 * 1024)
+
+#define DEFAULT_MAX_THREADS 2
+
+/* Batch several new hashes in one write to disk */
+#define SAVE_TIMEOUT_SECONDS 2
+#define CACHE_GROUP "hashes"
+/* When each hash was last used, in seconds since the epoch */
+#define SEEN_GROUP "seen"
+
+/* Hashes of files gone for a while are dropped when saving, as the least
+ * recently used ones past a limit. The time they were used is only kept
+ * to the day so that hits rarely need a save. */
+#define MAX_AGE (90 * 24 * 60 * 60)
+#define MAX_ENTRIES 20000
+#define SEEN_RESOLUTION (24 * 60 * 60)
+
+typedef struct
+{
+  gchar  *path;
+  gchar  *hash;
+  gint64  size;
+} HashJob;
+
+typedef struct
+{
+  gchar  *hash;
+  gint64  seen;
+} CacheEntry;
+
+typedef struct _TotemHashPoolPrivate
+{
+  GThreadPool *pool;
+
+  /* "inode-mtime-size" -> CacheEntry, shared with the workers. It is kept on
+   * disk so that a cold start does not read every file again. */
+  GMutex      lock;
+  GHashTable *cache;
+  gchar      *filename;
+  guint       save_id;
+  /* Held while the cache is written, so that an older snapshot never
+   * replaces a newer one */
+  GMutex      save_lock;
+
+  guint   files;
+  guint   cache_hits;
+  guint64 bytes;
+  guint   running;
+  gint64  busy_since;
+  gint64  busy_time;
+} TotemHashPoolPrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemHashPool, totem_hash_pool, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static void
+hash_job_free (HashJob *job)
+{
+  g_free (job->path);
+  g_free (job->hash);
+  g_slice_free (HashJob, job);
+}
+
+static CacheEntry *
+cache_entry_new (gchar  *hash,
+                 gint64  seen)
+{
+  CacheEntry *entry;
+
+  entry = g_slice_new (CacheEntry);
+  entry->hash = hash;
+  entry->seen = seen;
+  return entry;
+}
+
+static void
+cache_entry_free (CacheEntry *entry)
+{
+  g_free (entry->hash);
+  g_slice_free (CacheEntry, entry);
+}
+
+static gint64
+get_now (void)
+{
+  return g_get_real_time () / G_USEC_PER_SEC;
+}
+
+static gint
+compare_by_seen (gconstpointer a,
+                 gconstpointer b,
+                 gpointer      user_data)
+{
+  GHashTable *cache = user_data;
+  const CacheEntry *ea = g_hash_table_lookup (cache, *(const gchar **) a);
+  const CacheEntry *eb = g_hash_table_lookup (cache, *(const gchar **) b);
+
+  /* Most recent first */
+  return (ea->seen < eb->seen) - (ea->seen > eb->seen);
+}
+
+/* Called with the lock held. Drops the hashes not used for MAX_AGE, then
+ * the least recently used ones over MAX_ENTRIES. */
+static void
+prune_cache (TotemHashPool *self)
+{
+  TotemHashPoolPrivate *priv = self->priv;
+  GHashTableIter iter;
+  CacheEntry *entry;
+  const gchar *key;
+  GPtrArray *keys;
+  gint64 oldest;
+  guint i;
+
+  oldest = get_now () - MAX_AGE;
+  g_hash_table_iter_init (&iter, priv->cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry)) {
+    if (entry->seen < oldest)
+      g_hash_table_iter_remove (&iter);
+  }
+
+  if (g_hash_table_size (priv->cache) <= MAX_ENTRIES)
+    return;
+
+  keys = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, priv->cache);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    g_ptr_array_add (keys, (gpointer) key);
+  g_ptr_array_sort_with_data (keys, compare_by_seen, priv->cache);
+
+  /* Most recent first, drop the tail */
+  for (i = keys->len; i > MAX_ENTRIES; i--)
+    g_hash_table_remove (priv->cache, g_ptr_array_index (keys, i - 1));
+  g_ptr_array_unref (keys);
+}
+
+static gchar *
+serialize_cache (TotemHashPool *self)
+{
+  TotemHashPoolPrivate *priv = self->priv;
+  GHashTableIter iter;
+  CacheEntry *entry;
+  const gchar *key;
+  GKeyFile *keyfile;
+  gchar *data;
+
+  keyfile = g_key_file_new ();
+  g_mutex_lock (&priv->lock);
+  prune_cache (self);
+  g_hash_table_iter_init (&iter, priv->cache);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, (gpointer *) &entry)) {
+    g_key_file_set_string (keyfile, CACHE_GROUP, key, entry->hash);
+    g_key_file_set_int64 (keyfile, SEEN_GROUP, key, entry->seen);
+  }
+  g_mutex_unlock (&priv->lock);
+
+  data = g_key_file_to_data (keyfile, NULL, NULL);
+  g_key_file_unref (keyfile);
+  return data;
+}
+
+static void
+save_cache (TotemHashPool *self)
+{
+  TotemHashPoolPrivate *priv = self->priv;
+  GError *err = NULL;
+  gchar *dirname, *data;
+
+  g_mutex_lock (&priv->save_lock);
+  dirname = g_path_get_dirname (priv->filename);
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  data = serialize_cache (self);
+  if (!g_file_set_contents (priv->filename, data, -1, &err)) {
+    g_warning ("Failed to save hash cache: %s", err->message);
+    g_error_free (err);
+  }
+  g_free (data);
+  g_mutex_unlock (&priv->save_lock);
+}
+
+static void
+load_cache (TotemHashPool *self)
+{
+  TotemHashPoolPrivate *priv = self->priv;
+  GError *err = NULL;
+  GKeyFile *keyfile;
+  gchar **keys;
+  gint64 now;
+  guint i;
+
+  keyfile = g_key_file_new ();
+  if (!g_key_file_load_from_file (keyfile, priv->filename, G_KEY_FILE_NONE, &err)) {
+    if (!g_error_matches (err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      g_warning ("Failed to load hash cache: %s", err->message);
+    g_error_free (err);
+    g_key_file_unref (keyfile);
+    return;
+  }
+
+  now = get_now ();
+  keys = g_key_file_get_keys (keyfile, CACHE_GROUP, NULL, NULL);
+  for (i = 0; keys != NULL && keys[i] != NULL; i++) {
+    gchar *hash = g_key_file_get_string (keyfile, CACHE_GROUP, keys[i], NULL);
+    gint64 seen;
+
+    if (hash == NULL)
+      continue;
+
+    /* Hashes saved before their use was recorded start their age now */
+    seen = g_key_file_get_int64 (keyfile, SEEN_GROUP, keys[i], NULL);
+    if (seen <= 0)
+      seen = now;
+    g_hash_table_insert (priv->cache, g_strdup (keys[i]), cache_entry_new (hash, seen));
+  }
+  g_strfreev (keys);
+  g_key_file_unref (keyfile);
+}
+
+static void
+save_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  save_cache (TOTEM_HASH_POOL (source_object));
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Written out of the main thread */
+static gboolean
+save_timeout (gpointer user_data)
+{
+  TotemHashPool *self = user_data;
+  GTask *task;
+
+  g_mutex_lock (&self->priv->lock);
+  self->priv->save_id = 0;
+  g_mutex_unlock (&self->priv->lock);
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_run_in_thread (task, save_thread);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Called with the lock held, from any thread */
+static void
+queue_save (TotemHashPool *self)
+{
+  if (self->priv->save_id == 0)
+    self->priv->save_id = g_timeout_add_seconds (SAVE_TIMEOUT_SECONDS, save_timeout, self);
+}
+
+static gboolean
+sum_chunk (gint      fd,
+           goffset   offset,
+           gsize     len,
+           guint64  *hash,
+           GError  **error)
+{
+  guint64 buffer[CHUNK_SIZE / sizeof (guint64)];
+  gsize done, i;
+
+  memset (buffer, 0, sizeof (buffer));
+  done = 0;
+  while (done < len) {
+    gssize n = pread (fd, ((gchar *) buffer) + done, len - done, offset + done);
+
+    if (n < 0 && errno == EINTR)
+      continue;
+
+    /* The file got shorter since it was looked at */
+    if (n == 0) {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                   "Failed to read: unexpected end of file");
+      return FALSE;
+    }
+
+    if (n < 0) {
+      gint saved_errno = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Failed to read: %s", g_strerror (saved_errno));
+      return FALSE;
+    }
+    done += n;
+  }
+
+  for (i = 0; i < G_N_ELEMENTS (buffer); i++)
+    *hash += GUINT64_FROM_LE (buffer[i]);
+
+  return TRUE;
+}
+
+static void
+hash_thread (gpointer data,
+             gpointer user_data)
+{
+  GTask *task = data;
+  TotemHashPoolPrivate *priv = TOTEM_HASH_POOL (user_data)->priv;
+  HashJob *job = g_task_get_task_data (task);
+  CacheEntry *entry;
+  GError *err = NULL;
+  gchar *cache_key;
+  GStatBuf st;
+  guint64 hash;
+  gsize len;
+  gint fd;
+
+  if (g_task_return_error_if_cancelled (task)) {
+    g_object_unref (task);
+    return;
+  }
+
+  fd = g_open (job->path, O_RDONLY, 0);
+  if (fd < 0 || fstat (fd, &st) != 0) {
+    gint saved_errno = errno;
+
+    g_task_return_new_error (task, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                             "Failed to open %s: %s", job->path, g_strerror (saved_errno));
+    if (fd >= 0)
+      close (fd);
+    g_object_unref (task);
+    return;
+  }
+
+  job->size = st.st_size;
+  cache_key = g_strdup_printf ("%" G_GUINT64_FORMAT "-%" G_GINT64_FORMAT "-%" G_GINT64_FORMAT,
+                               (guint64) st.st_ino, (gint64) st.st_mtime, (gint64) st.st_size);
+
+  g_mutex_lock (&priv->lock);
+  entry = g_hash_table_lookup (priv->cache, cache_key);
+  if (entry != NULL) {
+    gint64 now = get_now ();
+
+    job->hash = g_strdup (entry->hash);
+    priv->cache_hits++;
+    if (now - entry->seen >= SEEN_RESOLUTION) {
+      entry->seen = now;
+      queue_save (TOTEM_HASH_POOL (user_data));
+    }
+  } else if (priv->running++ == 0) {
+    priv->busy_since = g_get_monotonic_time ();
+  }
+  g_mutex_unlock (&priv->lock);
+
+  if (job->hash != NULL) {
+    close (fd);
+    g_free (cache_key);
+    g_task_return_boolean (task, TRUE);
+    g_object_unref (task);
+    return;
+  }
+
+  /* Small files overlap, as other implementations do */
+  len = MIN (job->size, CHUNK_SIZE);
+  hash = job->size;
+  if (sum_chunk (fd, 0, len, &hash, &err) &&
+      sum_chunk (fd, MAX (0, job->size - CHUNK_SIZE), len, &hash, &err))
+    job->hash = g_strdup_printf ("%016" G_GINT64_MODIFIER "x", hash);
+  close (fd);
+
+  g_mutex_lock (&priv->lock);
+  if (--priv->running == 0)
+    priv->busy_time += g_get_monotonic_time () - priv->busy_since;
+  if (job->hash != NULL) {
+    priv->files++;
+    priv->bytes += 2 * len;
+    g_hash_table_insert (priv->cache, cache_key,
+                         cache_entry_new (g_strdup (job->hash), get_now ()));
+    cache_key = NULL;
+    queue_save (TOTEM_HASH_POOL (user_data));
+  }
+  g_mutex_unlock (&priv->lock);
+
+  g_free (cache_key);
+  if (err != NULL)
+    g_task_return_error (task, err);
+  else
+    g_task_return_boolean (task, TRUE);
+  g_object_unref (task);
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* @filename, where the hashes are kept between runs, defaults to a file in
+ * the user's cache directory. @max_threads should match what the disk can
+ * serve in parallel; 0 means the default of 2. */
+TotemHashPool *
+totem_hash_pool_new (const gchar *filename,
+                     gint         max_threads)
+{
+  TotemHashPool *self;
+  GError *err = NULL;
+
+  self = g_object_new (TOTEM_TYPE_HASH_POOL, NULL);
+  if (filename != NULL)
+    self->priv->filename = g_strdup (filename);
+  else
+    self->priv->filename = g_build_filename (g_get_user_cache_dir (),
+                                             "totem-series",
+                                             "hashes.cache",
+                                             NULL);
+  load_cache (self);
+
+  self->priv->pool = g_thread_pool_new (hash_thread, self,
+                                        (max_threads > 0) ? max_threads : DEFAULT_MAX_THREADS,
+                                        FALSE, &err);
+  if (err != NULL) {
+    g_warning ("Failed to create hash thread pool: %s", err->message);
+    g_error_free (err);
+  }
+
+  return self;
+}
+
+void
+totem_hash_pool_set_max_threads (TotemHashPool *self,
+                                 gint           max_threads)
+{
+  g_return_if_fail (TOTEM_IS_HASH_POOL (self));
+  g_return_if_fail (max_threads > 0);
+
+  g_thread_pool_set_max_threads (self->priv->pool, max_threads, NULL);
+}
+
+/* Hash the local file at @path in a worker thread. Results are cached by
+ * inode, modification time and size, also on disk. */
+void
+totem_hash_pool_compute_async (TotemHashPool       *self,
+                               const gchar         *path,
+                               GCancellable        *cancellable,
+                               GAsyncReadyCallback  callback,
+                               gpointer             user_data)
+{
+  HashJob *job;
+  GTask *task;
+
+  g_return_if_fail (TOTEM_IS_HASH_POOL (self));
+  g_return_if_fail (path != NULL);
+
+  job = g_slice_new0 (HashJob);
+  job->path = g_strdup (path);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, job, (GDestroyNotify) hash_job_free);
+
+  /* The pool holds the reference on the task until the worker is done */
+  g_thread_pool_push (self->priv->pool, task, NULL);
+}
+
+/* Returns the hash as the "gibest-hash" grilo key expects it; @size is set
+ * to the size of the file */
+gchar *
+totem_hash_pool_compute_finish (TotemHashPool  *self,
+                                GAsyncResult   *res,
+                                gint64         *size,
+                                GError        **error)
+{
+  HashJob *job;
+
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  if (!g_task_propagate_boolean (G_TASK (res), error))
+    return NULL;
+
+  job = g_task_get_task_data (G_TASK (res));
+  if (size != NULL)
+    *size = job->size;
+  return g_strdup (job->hash);
+}
+
+void
+totem_hash_pool_get_stats (TotemHashPool      *self,
+                           TotemHashPoolStats *stats)
+{
+  TotemHashPoolPrivate *priv;
+  gint64 busy_time;
+
+  g_return_if_fail (TOTEM_IS_HASH_POOL (self));
+  g_return_if_fail (stats != NULL);
+
+  priv = self->priv;
+  g_mutex_lock (&priv->lock);
+  busy_time = priv->busy_time;
+  if (priv->running > 0)
+    busy_time += g_get_monotonic_time () - priv->busy_since;
+
+  stats->files = priv->files;
+  stats->cache_hits = priv->cache_hits;
+  stats->bytes = priv->bytes;
+  g_mutex_unlock (&priv->lock);
+
+  stats->seconds = busy_time / (gdouble) G_USEC_PER_SEC;
+  stats->throughput = (busy_time > 0) ?
+    (stats->bytes / (1024.0 * 1024.0)) / stats->seconds : 0;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_hash_pool_finalize (GObject *object)
+{
+  TotemHashPool *self = TOTEM_HASH_POOL (object);
+  TotemHashPoolPrivate *priv = self->priv;
+
+  /* Saves still running hold a reference, this one is the last */
+  if (priv->save_id != 0) {
+    g_source_remove (priv->save_id);
+    priv->save_id = 0;
+    save_cache (self);
+  }
+
+  g_clear_pointer (&priv->cache, g_hash_table_unref);
+  g_clear_pointer (&priv->filename, g_free);
+  g_mutex_clear (&priv->lock);
+  g_mutex_clear (&priv->save_lock);
+
+  G_OBJECT_CLASS (totem_hash_pool_parent_class)->finalize (object);
+}
+
+static void
+totem_hash_pool_dispose (GObject *object)
+{
+  TotemHashPoolPrivate *priv = TOTEM_HASH_POOL (object)->priv;
+
+  /* Queued jobs still run, they are cheap compared to a blocked worker
+   * touching a finalized pool */
+  if (priv->pool != NULL) {
+    g_thread_pool_free (priv->pool, FALSE, TRUE);
+    priv->pool = NULL;
+  }
+
+  G_OBJECT_CLASS (totem_hash_pool_parent_class)->dispose (object);
+}
+
+static void
+totem_hash_pool_init (TotemHashPool *self)
+{
+  self->priv = totem_hash_pool_get_instance_private (self);
+
+  g_mutex_init (&self->priv->lock);
+  g_mutex_init (&self->priv->save_lock);
+  self->priv->cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                             (GDestroyNotify) cache_entry_free);
+}
+
+static void
+totem_hash_pool_class_init (TotemHashPoolClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->dispose = totem_hash_pool_dispose;
+  object_class->finalize = totem_hash_pool_finalize;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_HASH_POOL_H
+#define TOTEM_HASH_POOL_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_HASH_POOL             (totem_hash_pool_get_type())
+
+#define TOTEM_HASH_POOL(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_HASH_POOL, TotemHashPool))
+#define TOTEM_HASH_POOL_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_HASH_POOL, TotemHashPoolClass))
+#define TOTEM_IS_HASH_POOL(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_HASH_POOL))
+#define TOTEM_IS_HASH_POOL_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_HASH_POOL))
+#define TOTEM_HASH_POOL_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_HASH_POOL, TotemHashPoolClass))
+
+typedef struct _TotemHashPool        TotemHashPool;
+typedef struct _TotemHashPoolClass   TotemHashPoolClass;
+typedef struct _TotemHashPoolPrivate TotemHashPoolPrivate;
+
+struct _TotemHashPool
+{
+  GObject parent_instance;
+  TotemHashPoolPrivate *priv;
+};
+
+struct _TotemHashPoolClass
+{
+  GObjectClass parent_class;
+};
+
+typedef struct
+{
+  guint   files;
+  guint   cache_hits;
+  guint64 bytes;
+  gdouble seconds;      /* Wall clock time with at least one file hashing */
+  gdouble throughput;   /* MiB/s over that time */
+} TotemHashPoolStats;
+
+GType               totem_hash_pool_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemHashPool *totem_hash_pool_new (const gchar *filename,
+                                    gint         max_threads);
+void totem_hash_pool_set_max_threads (TotemHashPool *self,
+                                      gint           max_threads);
+void totem_hash_pool_compute_async (TotemHashPool       *self,
+                                    const gchar         *path,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data);
+gchar *totem_hash_pool_compute_finish (TotemHashPool  *self,
+                                       GAsyncResult   *res,
+                                       gint64         *size,
+                                       GError        **error);
+void totem_hash_pool_get_stats (TotemHashPool      *self,
+                                TotemHashPoolStats *stats);
+
+G_END_DECLS
+
+#endif /* TOTEM_HASH_POOL_H */
@@ -0,0 +1,563 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#include "totem-metadata-cache.h"
+
+#include <glib/gstdio.h>
+#include <string.h>
+
+#include "totem-trace.h"
+
+typedef struct _TotemMetadataCachePrivate
+{
+  GKeyFile *keyfile;
+  gchar    *filename;
+  GList    *keys;
+  GrlKeyID  hash_key;
+  guint     failure_ttl;
+  guint     max_age;
+
+  guint save_id;
+} TotemMetadataCachePrivate;
+
+/* Batch several stores in one write to disk */
+#define SAVE_TIMEOUT_SECONDS 2
+
+/* Videos and shows that could not be resolved are not tried again until
+ * this time, in seconds since the epoch */
+#define FAILURE_KEY "failed-until"
+#define DEFAULT_FAILURE_TTL_SECONDS (7 * 24 * 60 * 60)
+#define SHOW_GROUP_PREFIX "show "
+
+/* Entries older than this are still used, but should be resolved again */
+#define STORED_KEY "stored-at"
+#define DEFAULT_MAX_AGE_SECONDS (7 * 24 * 60 * 60)
+
+/* Stale entries that could not be resolved again are kept as they are and
+ * not considered stale until this time, in seconds since the epoch */
+#define RETRY_KEY "retry-after"
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemMetadataCache, totem_metadata_cache, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+/* Videos are identified by its gibest hash and file size, which are not
+ * affected by renaming or moving the file around */
+static gchar *
+get_group_from_video (TotemMetadataCache *self,
+                      GrlMedia           *video)
+{
+  const gchar *hash;
+  gint64 size;
+
+  if (self->priv->hash_key == GRL_METADATA_KEY_INVALID)
+    return NULL;
+
+  hash = grl_data_get_string (GRL_DATA (video), self->priv->hash_key);
+  size = grl_media_get_size (video);
+  if (hash == NULL || *hash == '\0' || size <= 0)
+    return NULL;
+
+  return g_strdup_printf ("%s-%" G_GINT64_FORMAT, hash, size);
+}
+
+static void
+store_key (GKeyFile    *keyfile,
+           const gchar *group,
+           GrlData     *data,
+           GrlKeyID     key)
+{
+  const gchar *name;
+  GType type;
+
+  if (!grl_data_has_key (data, key))
+    return;
+
+  name = grl_metadata_key_get_name (key);
+  type = grl_metadata_key_get_type (key);
+
+  if (type == G_TYPE_STRING) {
+    const gchar **values;
+    guint i, len;
+
+    /* Keys as performer or director might have several values */
+    len = grl_data_length (data, key);
+    values = g_new0 (const gchar *, len + 1);
+    for (i = 0; i < len; i++) {
+      GrlRelatedKeys *relkeys;
+
+      relkeys = grl_data_get_related_keys (data, key, i);
+      values[i] = grl_related_keys_get_string (relkeys, key);
+      if (values[i] == NULL)
+        values[i] = "";
+    }
+    g_key_file_set_string_list (keyfile, group, name, values, len);
+    g_free (values);
+  } else if (type == G_TYPE_INT) {
+    g_key_file_set_integer (keyfile, group, name, grl_data_get_int (data, key));
+  } else if (type == G_TYPE_DATE_TIME) {
+    GDateTime *date = grl_data_get_boxed (data, key);
+
+    if (date != NULL)
+      g_key_file_set_int64 (keyfile, group, name, g_date_time_to_unix (date));
+  } else {
+    g_debug ("Metadata cache does not handle key %s", name);
+  }
+}
+
+static void
+restore_key (GKeyFile    *keyfile,
+             const gchar *group,
+             GrlData     *data,
+             GrlKeyID     key)
+{
+  const gchar *name;
+  GType type;
+
+  name = grl_metadata_key_get_name (key);
+  if (!g_key_file_has_key (keyfile, group, name, NULL))
+    return;
+
+  type = grl_metadata_key_get_type (key);
+  if (type == G_TYPE_STRING) {
+    gchar **values;
+    guint i;
+
+    values = g_key_file_get_string_list (keyfile, group, name, NULL, NULL);
+    if (values == NULL)
+      return;
+
+    while (grl_data_length (data, key) > 0)
+      grl_data_remove (data, key);
+
+    for (i = 0; values[i] != NULL; i++)
+      grl_data_add_string (data, key, values[i]);
+    g_strfreev (values);
+  } else if (type == G_TYPE_INT) {
+    grl_data_set_int (data, key, g_key_file_get_integer (keyfile, group, name, NULL));
+  } else if (type == G_TYPE_DATE_TIME) {
+    GDateTime *date;
+
+    date = g_date_time_new_from_unix_utc (g_key_file_get_int64 (keyfile, group, name, NULL));
+    grl_data_set_boxed (data, key, date);
+    g_date_time_unref (date);
+  }
+}
+
+static gboolean
+save_timeout (gpointer user_data)
+{
+  TotemMetadataCache *self = user_data;
+  GError *err = NULL;
+
+  self->priv->save_id = 0;
+  if (!totem_metadata_cache_save (self, &err)) {
+    g_warning ("Failed to save metadata cache: %s", err->message);
+    g_error_free (err);
+  }
+  return G_SOURCE_REMOVE;
+}
+
+static void
+queue_save (TotemMetadataCache *self)
+{
+  if (self->priv->save_id == 0)
+    self->priv->save_id = g_timeout_add_seconds (SAVE_TIMEOUT_SECONDS, save_timeout, self);
+}
+
+/* Everything stored for @group but the times, to find out what changed */
+static gchar *
+get_group_data (GKeyFile    *keyfile,
+                const gchar *group)
+{
+  gchar **keys;
+  GString *data;
+  guint i;
+
+  keys = g_key_file_get_keys (keyfile, group, NULL, NULL);
+  if (keys == NULL)
+    return NULL;
+
+  data = g_string_new (NULL);
+  for (i = 0; keys[i] != NULL; i++) {
+    gchar *value;
+
+    if (g_str_equal (keys[i], STORED_KEY) || g_str_equal (keys[i], RETRY_KEY))
+      continue;
+
+    value = g_key_file_get_value (keyfile, group, keys[i], NULL);
+    g_string_append_printf (data, "%s=%s\n", keys[i], value);
+    g_free (value);
+  }
+  g_strfreev (keys);
+
+  return g_string_free (data, FALSE);
+}
+
+static gchar *
+get_group_from_show (const gchar *show)
+{
+  return g_strconcat (SHOW_GROUP_PREFIX, show, NULL);
+}
+
+static void
+store_failure (TotemMetadataCache *self,
+               const gchar        *group)
+{
+  gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+
+  g_key_file_remove_group (self->priv->keyfile, group, NULL);
+  g_key_file_set_int64 (self->priv->keyfile, group, FAILURE_KEY,
+                        now + self->priv->failure_ttl);
+  queue_save (self);
+}
+
+/* Expired failures are dropped so that they are tried again */
+static gboolean
+has_failed (TotemMetadataCache *self,
+            const gchar        *group)
+{
+  GKeyFile *keyfile = self->priv->keyfile;
+  gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+
+  if (!g_key_file_has_key (keyfile, group, FAILURE_KEY, NULL))
+    return FALSE;
+
+  if (g_key_file_get_int64 (keyfile, group, FAILURE_KEY, NULL) > now)
+    return TRUE;
+
+  g_key_file_remove_group (keyfile, group, NULL);
+  queue_save (self);
+  return FALSE;
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* @filename defaults to a file in the user's cache directory; @keys are the
+ * GrlKeyIDs that are stored for each video */
+TotemMetadataCache *
+totem_metadata_cache_new (const gchar *filename,
+                          const GList *keys)
+{
+  TotemMetadataCache *self;
+  TotemMetadataCachePrivate *priv;
+  GError *err = NULL;
+
+  self = g_object_new (TOTEM_TYPE_METADATA_CACHE, NULL);
+  priv = self->priv;
+
+  if (filename != NULL)
+    priv->filename = g_strdup (filename);
+  else
+    priv->filename = g_build_filename (g_get_user_cache_dir (),
+                                       "totem-series",
+                                       "metadata.cache",
+                                       NULL);
+  priv->keys = g_list_copy ((GList *) keys);
+  priv->hash_key = grl_registry_lookup_metadata_key (grl_registry_get_default (),
+                                                     "gibest-hash");
+
+  if (!g_key_file_load_from_file (priv->keyfile, priv->filename,
+                                  G_KEY_FILE_NONE, &err)) {
+    if (!g_error_matches (err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      g_warning ("Failed to load metadata cache: %s", err->message);
+    g_error_free (err);
+  }
+
+  return self;
+}
+
+/* Fill @video with cached metadata. Returns FALSE if @video is not in the
+ * cache. */
+gboolean
+totem_metadata_cache_lookup (TotemMetadataCache *self,
+                             GrlMedia           *video)
+{
+  TotemMetadataCachePrivate *priv;
+  gchar *group;
+  GList *it;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  priv = self->priv;
+  group = get_group_from_video (self, video);
+  if (group == NULL || !g_key_file_has_group (priv->keyfile, group) ||
+      g_key_file_has_key (priv->keyfile, group, FAILURE_KEY, NULL)) {
+    g_free (group);
+    return FALSE;
+  }
+
+  for (it = priv->keys; it != NULL; it = it->next)
+    restore_key (priv->keyfile, group, GRL_DATA (video), GRLPOINTER_TO_KEYID (it->data));
+
+  g_free (group);
+  return TRUE;
+}
+
+/* Returns TRUE if the metadata of @video differs from the one cached */
+gboolean
+totem_metadata_cache_store (TotemMetadataCache *self,
+                            GrlMedia           *video)
+{
+  TotemMetadataCachePrivate *priv;
+  gchar *group, *old_data, *new_data;
+  gboolean changed;
+  GList *it;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  priv = self->priv;
+  group = get_group_from_video (self, video);
+  if (group == NULL)
+    return FALSE;
+
+  old_data = get_group_data (priv->keyfile, group);
+  g_key_file_remove_group (priv->keyfile, group, NULL);
+  for (it = priv->keys; it != NULL; it = it->next)
+    store_key (priv->keyfile, group, GRL_DATA (video), GRLPOINTER_TO_KEYID (it->data));
+  new_data = get_group_data (priv->keyfile, group);
+  g_key_file_set_int64 (priv->keyfile, group, STORED_KEY,
+                        g_get_real_time () / G_USEC_PER_SEC);
+
+  changed = (g_strcmp0 (old_data, new_data) != 0);
+  g_free (old_data);
+  g_free (new_data);
+  g_free (group);
+  queue_save (self);
+
+  return changed;
+}
+
+/* Whether the cached metadata of @video is older than the maximum age, or
+ * not cached at all */
+gboolean
+totem_metadata_cache_is_stale (TotemMetadataCache *self,
+                               GrlMedia           *video)
+{
+  gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+  gboolean stale;
+  gchar *group;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), TRUE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), TRUE);
+
+  group = get_group_from_video (self, video);
+  if (group == NULL)
+    return TRUE;
+
+  /* Entries from before the time was stored are stale as well */
+  stale = !g_key_file_has_key (self->priv->keyfile, group, STORED_KEY, NULL) ||
+          now - g_key_file_get_int64 (self->priv->keyfile, group, STORED_KEY, NULL) > self->priv->max_age;
+  if (stale && g_key_file_has_key (self->priv->keyfile, group, RETRY_KEY, NULL))
+    stale = g_key_file_get_int64 (self->priv->keyfile, group, RETRY_KEY, NULL) <= now;
+  g_free (group);
+
+  return stale;
+}
+
+/* Resolving @video again did not tell anything; its stale entry is kept
+ * and only resolved again once the failure expires */
+void
+totem_metadata_cache_postpone (TotemMetadataCache *self,
+                               GrlMedia           *video)
+{
+  gint64 now = g_get_real_time () / G_USEC_PER_SEC;
+  gchar *group;
+
+  g_return_if_fail (TOTEM_IS_METADATA_CACHE (self));
+  g_return_if_fail (GRL_IS_MEDIA (video));
+
+  group = get_group_from_video (self, video);
+  if (group == NULL)
+    return;
+
+  if (g_key_file_has_group (self->priv->keyfile, group) &&
+      !g_key_file_has_key (self->priv->keyfile, group, FAILURE_KEY, NULL)) {
+    g_key_file_set_int64 (self->priv->keyfile, group, RETRY_KEY,
+                          now + self->priv->failure_ttl);
+    queue_save (self);
+  }
+  g_free (group);
+}
+
+/* How long cached metadata is considered fresh, a week by default */
+void
+totem_metadata_cache_set_max_age (TotemMetadataCache *self,
+                                  guint               seconds)
+{
+  g_return_if_fail (TOTEM_IS_METADATA_CACHE (self));
+
+  self->priv->max_age = seconds;
+}
+
+/* Remember that @video could not be resolved, e.g. its name could not be
+ * parsed, so that it is skipped until the failure expires */
+void
+totem_metadata_cache_store_failure (TotemMetadataCache *self,
+                                    GrlMedia           *video)
+{
+  gchar *group;
+
+  g_return_if_fail (TOTEM_IS_METADATA_CACHE (self));
+  g_return_if_fail (GRL_IS_MEDIA (video));
+
+  group = get_group_from_video (self, video);
+  if (group == NULL)
+    return;
+
+  store_failure (self, group);
+  g_free (group);
+}
+
+gboolean
+totem_metadata_cache_has_failed (TotemMetadataCache *self,
+                                 GrlMedia           *video)
+{
+  gboolean failed;
+  gchar *group;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  group = get_group_from_video (self, video);
+  if (group == NULL)
+    return FALSE;
+
+  failed = has_failed (self, group);
+  g_free (group);
+  return failed;
+}
+
+/* As totem_metadata_cache_store_failure() for a whole show, e.g. unknown
+ * to the metadata source. @show should be normalized by the caller. */
+void
+totem_metadata_cache_store_show_failure (TotemMetadataCache *self,
+                                         const gchar        *show)
+{
+  gchar *group;
+
+  g_return_if_fail (TOTEM_IS_METADATA_CACHE (self));
+  g_return_if_fail (show != NULL);
+
+  group = get_group_from_show (show);
+  store_failure (self, group);
+  g_free (group);
+}
+
+gboolean
+totem_metadata_cache_show_has_failed (TotemMetadataCache *self,
+                                      const gchar        *show)
+{
+  gboolean failed;
+  gchar *group;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), FALSE);
+  g_return_val_if_fail (show != NULL, FALSE);
+
+  group = get_group_from_show (show);
+  failed = has_failed (self, group);
+  g_free (group);
+  return failed;
+}
+
+/* How long failures are remembered, a week by default */
+void
+totem_metadata_cache_set_failure_ttl (TotemMetadataCache *self,
+                                      guint               seconds)
+{
+  g_return_if_fail (TOTEM_IS_METADATA_CACHE (self));
+
+  self->priv->failure_ttl = seconds;
+}
+
+gboolean
+totem_metadata_cache_save (TotemMetadataCache  *self,
+                           GError             **error)
+{
+  TotemMetadataCachePrivate *priv;
+  gchar *dirname;
+  gboolean saved;
+  gint64 start;
+
+  g_return_val_if_fail (TOTEM_IS_METADATA_CACHE (self), FALSE);
+
+  priv = self->priv;
+  if (priv->save_id != 0) {
+    g_source_remove (priv->save_id);
+    priv->save_id = 0;
+  }
+
+  dirname = g_path_get_dirname (priv->filename);
+  g_mkdir_with_parents (dirname, 0700);
+  g_free (dirname);
+
+  /* g_key_file_save_to_file() writes to a temporary file first */
+  start = g_get_monotonic_time ();
+  saved = g_key_file_save_to_file (priv->keyfile, priv->filename, error);
+  totem_trace_span ("metadata-save", start, g_get_monotonic_time (), priv->filename);
+
+  return saved;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_metadata_cache_finalize (GObject *object)
+{
+  TotemMetadataCache *self = TOTEM_METADATA_CACHE (object);
+  TotemMetadataCachePrivate *priv = self->priv;
+
+  if (priv->save_id != 0)
+    save_timeout (self);
+
+  g_clear_pointer (&priv->keyfile, g_key_file_unref);
+  g_clear_pointer (&priv->filename, g_free);
+  g_clear_pointer (&priv->keys, g_list_free);
+
+  G_OBJECT_CLASS (totem_metadata_cache_parent_class)->finalize (object);
+}
+
+static void
+totem_metadata_cache_init (TotemMetadataCache *self)
+{
+  self->priv = totem_metadata_cache_get_instance_private (self);
+  self->priv->keyfile = g_key_file_new ();
+  self->priv->failure_ttl = DEFAULT_FAILURE_TTL_SECONDS;
+  self->priv->max_age = DEFAULT_MAX_AGE_SECONDS;
+}
+
+static void
+totem_metadata_cache_class_init (TotemMetadataCacheClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = totem_metadata_cache_finalize;
+}
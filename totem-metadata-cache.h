@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_METADATA_CACHE_H
+#define TOTEM_METADATA_CACHE_H
+
+#include <grilo.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_METADATA_CACHE             (totem_metadata_cache_get_type())
+
+#define TOTEM_METADATA_CACHE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_METADATA_CACHE, TotemMetadataCache))
+#define TOTEM_METADATA_CACHE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_METADATA_CACHE, TotemMetadataCacheClass))
+#define TOTEM_IS_METADATA_CACHE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_METADATA_CACHE))
+#define TOTEM_IS_METADATA_CACHE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_METADATA_CACHE))
+#define TOTEM_METADATA_CACHE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_METADATA_CACHE, TotemMetadataCacheClass))
+
+typedef struct _TotemMetadataCache        TotemMetadataCache;
+typedef struct _TotemMetadataCacheClass   TotemMetadataCacheClass;
+typedef struct _TotemMetadataCachePrivate TotemMetadataCachePrivate;
+
+struct _TotemMetadataCache
+{
+  GObject parent_instance;
+  TotemMetadataCachePrivate *priv;
+};
+
+struct _TotemMetadataCacheClass
+{
+  GObjectClass parent_class;
+};
+
+GType               totem_metadata_cache_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemMetadataCache *totem_metadata_cache_new (const gchar *filename,
+                                              const GList *keys);
+gboolean totem_metadata_cache_lookup (TotemMetadataCache *self,
+                                      GrlMedia           *video);
+gboolean totem_metadata_cache_store (TotemMetadataCache *self,
+                                     GrlMedia           *video);
+gboolean totem_metadata_cache_is_stale (TotemMetadataCache *self,
+                                        GrlMedia           *video);
+void totem_metadata_cache_set_max_age (TotemMetadataCache *self,
+                                       guint               seconds);
+void totem_metadata_cache_postpone (TotemMetadataCache *self,
+                                    GrlMedia           *video);
+void totem_metadata_cache_store_failure (TotemMetadataCache *self,
+                                         GrlMedia           *video);
+gboolean totem_metadata_cache_has_failed (TotemMetadataCache *self,
+                                          GrlMedia           *video);
+void totem_metadata_cache_store_show_failure (TotemMetadataCache *self,
+                                              const gchar        *show);
+gboolean totem_metadata_cache_show_has_failed (TotemMetadataCache *self,
+                                               const gchar        *show);
+void totem_metadata_cache_set_failure_ttl (TotemMetadataCache *self,
+                                           guint               seconds);
+gboolean totem_metadata_cache_save (TotemMetadataCache  *self,
+                                    GError             **error);
+
+G_END_DECLS
+
+#endif /* TOTEM_METADATA_CACHE_H */
@@ -0,0 +1,707 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#include "totem-mock-source.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "totem-title-parser.h"
+
+/* A GrlSource standing for the online ones, e.g. grl-thetvdb, so that the
+ * pipeline can run without network and with reproducible timings.
+ *
+ * Resolves are answered from a fixture directory, one key file per show:
+ *
+ *   [show]
+ *   name=Breaking Bad
+ *   description=A chemistry teacher...
+ *   performer=Bryan Cranston;Aaron Paul
+ *   poster=breaking-bad.jpg
+ *
+ *   [S01E01]
+ *   episode-title=Pilot
+ *   publication-date=2008-01-20
+ *
+ * Keys are grilo metadata key names; "poster" stands for any *-poster key
+ * and is relative to the poster url. Without fixtures, metadata is made up
+ * from the show, season and episode. */
+
+typedef struct _TotemMockSourcePrivate
+{
+  /* Casefolded show name -> GKeyFile */
+  GHashTable *fixtures;
+  gchar      *poster_url;
+
+  guint    latency_ms;
+  guint    jitter_ms;
+  gdouble  error_rate;
+  guint    rate_limit;
+  GRand   *rand;
+
+  /* Requests in the current one second window */
+  gint64 window_start;
+  guint  window_count;
+
+  guint resolve_count;
+  guint error_count;
+} TotemMockSourcePrivate;
+
+typedef struct
+{
+  GrlSourceResolveSpec *rs;
+  GError               *error;
+} Reply;
+
+#define FIXTURE_SHOW_GROUP "show"
+#define FIXTURE_POSTER_KEY "poster"
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemMockSource, totem_mock_source, GRL_TYPE_SOURCE);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static GKeyFile *
+lookup_fixture (TotemMockSource *self,
+                const gchar     *show)
+{
+  GKeyFile *fixture;
+  gchar *folded;
+
+  if (self->priv->fixtures == NULL)
+    return NULL;
+
+  folded = g_utf8_casefold (show, -1);
+  fixture = g_hash_table_lookup (self->priv->fixtures, folded);
+  g_free (folded);
+
+  return fixture;
+}
+
+static gchar *
+get_poster_url (TotemMockSource *self,
+                const gchar     *poster)
+{
+  gchar *escaped, *url;
+
+  if (g_str_has_prefix (poster, "http://") || g_str_has_prefix (poster, "https://"))
+    return g_strdup (poster);
+
+  if (self->priv->poster_url == NULL)
+    return NULL;
+
+  escaped = g_uri_escape_string (poster, NULL, FALSE);
+  url = g_strdup_printf ("%s/%s", self->priv->poster_url, escaped);
+  g_free (escaped);
+
+  return url;
+}
+
+static GDateTime *
+parse_date (const gchar *str)
+{
+  gint year, month, day;
+
+  if (str == NULL || sscanf (str, "%d-%d-%d", &year, &month, &day) != 3)
+    return NULL;
+
+  return g_date_time_new_utc (year, month, day, 0, 0, 0);
+}
+
+/* Episode values first, then the show ones */
+static void
+fill_key_from_fixture (TotemMockSource *self,
+                       GrlMedia        *media,
+                       GKeyFile        *fixture,
+                       GrlKeyID         key)
+{
+  const gchar *groups[2], *name;
+  gchar *episode_group;
+  gboolean is_poster;
+  GType type;
+  guint i;
+
+  name = grl_metadata_key_get_name (key);
+  is_poster = g_str_has_suffix (name, "poster");
+  if (is_poster)
+    name = FIXTURE_POSTER_KEY;
+  type = grl_metadata_key_get_type (key);
+
+  episode_group = g_strdup_printf ("S%02dE%02d",
+                                   grl_media_get_season (media),
+                                   grl_media_get_episode (media));
+  groups[0] = episode_group;
+  groups[1] = FIXTURE_SHOW_GROUP;
+
+  for (i = 0; i < G_N_ELEMENTS (groups); i++) {
+    if (!g_key_file_has_key (fixture, groups[i], name, NULL))
+      continue;
+
+    if (type == G_TYPE_STRING) {
+      gchar **values;
+      guint j;
+
+      values = g_key_file_get_string_list (fixture, groups[i], name, NULL, NULL);
+      for (j = 0; values != NULL && values[j] != NULL; j++) {
+        if (is_poster) {
+          gchar *url = get_poster_url (self, values[j]);
+
+          if (url != NULL)
+            grl_data_add_string (GRL_DATA (media), key, url);
+          g_free (url);
+        } else {
+          grl_data_add_string (GRL_DATA (media), key, values[j]);
+        }
+      }
+      g_strfreev (values);
+    } else if (type == G_TYPE_INT) {
+      grl_data_set_int (GRL_DATA (media), key,
+                        g_key_file_get_integer (fixture, groups[i], name, NULL));
+    } else if (type == G_TYPE_DATE_TIME) {
+      gchar *value = g_key_file_get_string (fixture, groups[i], name, NULL);
+      GDateTime *date = parse_date (value);
+
+      if (date != NULL) {
+        grl_data_set_boxed (GRL_DATA (media), key, date);
+        g_date_time_unref (date);
+      }
+      g_free (value);
+    }
+    break;
+  }
+
+  g_free (episode_group);
+}
+
+static void
+fill_key_synthetic (TotemMockSource *self,
+                    GrlMedia        *media,
+                    const gchar     *show,
+                    GrlKeyID         key)
+{
+  const gchar *name = grl_metadata_key_get_name (key);
+  GType type = grl_metadata_key_get_type (key);
+
+  if (type == G_TYPE_STRING) {
+    gchar *value;
+
+    if (g_str_has_suffix (name, "poster")) {
+      gchar *poster = g_strdup_printf ("%s.jpg", show);
+
+      value = get_poster_url (self, poster);
+      g_free (poster);
+      if (value == NULL)
+        return;
+    } else if (key == GRL_METADATA_KEY_EPISODE_TITLE) {
+      value = g_strdup_printf ("Episode %d of season %d",
+                               grl_media_get_episode (media),
+                               grl_media_get_season (media));
+    } else {
+      value = g_strdup_printf ("%s of %s", name, show);
+    }
+
+    grl_data_add_string (GRL_DATA (media), key, value);
+    g_free (value);
+  } else if (type == G_TYPE_DATE_TIME) {
+    GDateTime *date;
+
+    date = g_date_time_new_utc (1990 + MAX (grl_media_get_season (media), 0),
+                                1 + MAX (grl_media_get_episode (media) - 1, 0) % 12,
+                                1, 0, 0, 0);
+    grl_data_set_boxed (GRL_DATA (media), key, date);
+    g_date_time_unref (date);
+  }
+}
+
+static void
+fill_media (TotemMockSource *self,
+            GrlMedia        *media,
+            GList           *keys)
+{
+  const gchar *show;
+  GKeyFile *fixture;
+  GList *it;
+
+  /* Stands for grl-video-title-parsing */
+  if (grl_media_get_show (media) == NULL)
+    totem_title_parser_parse_media (media);
+
+  show = grl_media_get_show (media);
+  if (show == NULL)
+    show = grl_media_get_title (media);
+  if (show == NULL)
+    return;
+
+  fixture = lookup_fixture (self, show);
+  for (it = keys; it != NULL; it = it->next) {
+    GrlKeyID key = GRLPOINTER_TO_KEYID (it->data);
+
+    if (grl_data_has_key (GRL_DATA (media), key))
+      continue;
+
+    if (self->priv->fixtures != NULL) {
+      /* Unknown shows are not found, as online */
+      if (fixture != NULL)
+        fill_key_from_fixture (self, media, fixture, key);
+    } else {
+      fill_key_synthetic (self, media, show, key);
+    }
+  }
+}
+
+/* Like the online services, refuse requests over the limit */
+static gboolean
+is_rate_limited (TotemMockSource *self)
+{
+  TotemMockSourcePrivate *priv = self->priv;
+  gint64 now;
+
+  if (priv->rate_limit == 0)
+    return FALSE;
+
+  now = g_get_monotonic_time ();
+  if (now - priv->window_start >= G_USEC_PER_SEC) {
+    priv->window_start = now;
+    priv->window_count = 0;
+  }
+
+  return (++priv->window_count > priv->rate_limit);
+}
+
+static guint
+get_delay (TotemMockSource *self)
+{
+  TotemMockSourcePrivate *priv = self->priv;
+  gint delay = priv->latency_ms;
+
+  if (priv->jitter_ms > 0)
+    delay += g_rand_int_range (priv->rand, -(gint) priv->jitter_ms, priv->jitter_ms + 1);
+
+  return MAX (delay, 0);
+}
+
+static gboolean
+resolve_reply (gpointer user_data)
+{
+  Reply *reply = user_data;
+  GrlSourceResolveSpec *rs = reply->rs;
+  TotemMockSource *self = TOTEM_MOCK_SOURCE (rs->source);
+
+  if (reply->error == NULL)
+    fill_media (self, rs->media, rs->keys);
+  else
+    self->priv->error_count++;
+
+  self->priv->resolve_count++;
+  rs->callback (rs->source, rs->operation_id, rs->media, rs->user_data, reply->error);
+
+  g_clear_error (&reply->error);
+  g_slice_free (Reply, reply);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+load_fixture (TotemMockSource *self,
+              const gchar     *path)
+{
+  GKeyFile *fixture;
+  GError *err = NULL;
+  gchar *name, *folded;
+
+  fixture = g_key_file_new ();
+  if (!g_key_file_load_from_file (fixture, path, G_KEY_FILE_NONE, &err)) {
+    g_warning ("Failed to load fixture %s: %s", path, err->message);
+    g_error_free (err);
+    g_key_file_unref (fixture);
+    return;
+  }
+
+  name = g_key_file_get_string (fixture, FIXTURE_SHOW_GROUP, "name", NULL);
+  if (name == NULL) {
+    g_warning ("Fixture %s has no show name", path);
+    g_key_file_unref (fixture);
+    return;
+  }
+
+  folded = g_utf8_casefold (name, -1);
+  g_hash_table_insert (self->priv->fixtures, folded, fixture);
+  g_free (name);
+}
+
+/* HTTP stand-in for poster urls, one thread per connection */
+typedef struct
+{
+  gchar *directory;
+  guint  latency_ms;
+} HttpServer;
+
+static void
+http_server_free (HttpServer *http)
+{
+  g_free (http->directory);
+  g_slice_free (HttpServer, http);
+}
+
+static void
+http_reply (GOutputStream *out,
+            const gchar   *status,
+            const gchar   *body,
+            gsize          len)
+{
+  gchar *headers;
+
+  headers = g_strdup_printf ("HTTP/1.1 %s\r\n"
+                             "Content-Length: %" G_GSIZE_FORMAT "\r\n"
+                             "Connection: close\r\n"
+                             "\r\n", status, len);
+  if (g_output_stream_write_all (out, headers, strlen (headers), NULL, NULL, NULL) && len > 0)
+    g_output_stream_write_all (out, body, len, NULL, NULL, NULL);
+  g_free (headers);
+}
+
+static gboolean
+http_run (GThreadedSocketService *service,
+          GSocketConnection      *connection,
+          GObject                *source_object,
+          gpointer                user_data)
+{
+  HttpServer *http = user_data;
+  GDataInputStream *in;
+  GOutputStream *out;
+  gchar *line, **request, *name, *path, *contents;
+  gsize len;
+
+  in = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+  g_filter_input_stream_set_close_base_stream (G_FILTER_INPUT_STREAM (in), FALSE);
+  out = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+
+  line = g_data_input_stream_read_line (in, NULL, NULL, NULL);
+  request = (line != NULL) ? g_strsplit (line, " ", 3) : NULL;
+  g_free (line);
+
+  /* Headers are not used */
+  while ((line = g_data_input_stream_read_line (in, NULL, NULL, NULL)) != NULL) {
+    gboolean end = (*line == '\0' || g_str_equal (line, "\r"));
+
+    g_free (line);
+    if (end)
+      break;
+  }
+
+  if (request == NULL || g_strv_length (request) < 2 ||
+      !g_str_equal (request[0], "GET") || request[1][0] != '/') {
+    http_reply (out, "400 Bad Request", NULL, 0);
+    goto out;
+  }
+
+  if (http->latency_ms > 0)
+    g_usleep (http->latency_ms * 1000);
+
+  name = g_uri_unescape_string (request[1] + 1, NULL);
+  if (name == NULL || *name == '\0' || strchr (name, '/') != NULL || strstr (name, "..") != NULL) {
+    http_reply (out, "404 Not Found", NULL, 0);
+    g_free (name);
+    goto out;
+  }
+
+  path = g_build_filename (http->directory, name, NULL);
+  if (g_file_get_contents (path, &contents, &len, NULL)) {
+    http_reply (out, "200 OK", contents, len);
+    g_free (contents);
+  } else {
+    http_reply (out, "404 Not Found", NULL, 0);
+  }
+  g_free (path);
+  g_free (name);
+
+out:
+  g_strfreev (request);
+  g_object_unref (in);
+  return TRUE;
+}
+
+static const GList *
+totem_mock_source_supported_keys (GrlSource *source)
+{
+  static GList *keys = NULL;
+
+  if (keys == NULL)
+    keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                      GRL_METADATA_KEY_SHOW,
+                                      GRL_METADATA_KEY_SEASON,
+                                      GRL_METADATA_KEY_EPISODE,
+                                      GRL_METADATA_KEY_EPISODE_TITLE,
+                                      GRL_METADATA_KEY_DESCRIPTION,
+                                      GRL_METADATA_KEY_PERFORMER,
+                                      GRL_METADATA_KEY_DIRECTOR,
+                                      GRL_METADATA_KEY_AUTHOR,
+                                      GRL_METADATA_KEY_GENRE,
+                                      GRL_METADATA_KEY_PUBLICATION_DATE,
+                                      GRL_METADATA_KEY_INVALID);
+  return keys;
+}
+
+static gboolean
+totem_mock_source_may_resolve (GrlSource  *source,
+                               GrlMedia   *media,
+                               GrlKeyID    key_id,
+                               GList     **missing_keys)
+{
+  return TRUE;
+}
+
+static void
+totem_mock_source_resolve (GrlSource            *source,
+                           GrlSourceResolveSpec *rs)
+{
+  TotemMockSource *self = TOTEM_MOCK_SOURCE (source);
+  TotemMockSourcePrivate *priv = self->priv;
+  Reply *reply;
+
+  reply = g_slice_new0 (Reply);
+  reply->rs = rs;
+
+  if (is_rate_limited (self)) {
+    reply->error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_RESOLVE_FAILED,
+                                "Rate limit of %u requests per second exceeded",
+                                priv->rate_limit);
+  } else if (priv->error_rate > 0 && g_rand_double (priv->rand) < priv->error_rate) {
+    reply->error = g_error_new (GRL_CORE_ERROR, GRL_CORE_ERROR_RESOLVE_FAILED,
+                                "Mock failure of %s", grl_source_get_id (source));
+  }
+
+  g_timeout_add (get_delay (self), resolve_reply, reply);
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* Register a mock source as @source_id in the default registry. The
+ * registry owns it. */
+TotemMockSource *
+totem_mock_source_register (const gchar  *source_id,
+                            GError      **error)
+{
+  static GrlPlugin *plugin = NULL;
+  TotemMockSource *self;
+
+  g_return_val_if_fail (source_id != NULL, NULL);
+
+  if (plugin == NULL)
+    plugin = g_object_new (GRL_TYPE_PLUGIN, NULL);
+
+  self = g_object_new (TOTEM_TYPE_MOCK_SOURCE,
+                       "source-id", source_id,
+                       "source-name", source_id,
+                       NULL);
+
+  /* Same random sequence on every run */
+  g_rand_set_seed (self->priv->rand, g_str_hash (source_id));
+
+  if (!grl_registry_register_source (grl_registry_get_default (), plugin,
+                                     GRL_SOURCE (self), error))
+    return NULL;
+
+  return self;
+}
+
+/* Answer from the *.ini files in @directory instead of made up metadata */
+gboolean
+totem_mock_source_set_fixtures (TotemMockSource  *self,
+                                const gchar      *directory,
+                                GError          **error)
+{
+  const gchar *filename;
+  GDir *dir;
+
+  g_return_val_if_fail (TOTEM_IS_MOCK_SOURCE (self), FALSE);
+  g_return_val_if_fail (directory != NULL, FALSE);
+
+  dir = g_dir_open (directory, 0, error);
+  if (dir == NULL)
+    return FALSE;
+
+  g_clear_pointer (&self->priv->fixtures, g_hash_table_unref);
+  self->priv->fixtures = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                (GDestroyNotify) g_key_file_unref);
+
+  while ((filename = g_dir_read_name (dir)) != NULL) {
+    gchar *path;
+
+    if (!g_str_has_suffix (filename, ".ini"))
+      continue;
+
+    path = g_build_filename (directory, filename, NULL);
+    load_fixture (self, path);
+    g_free (path);
+  }
+  g_dir_close (dir);
+
+  return TRUE;
+}
+
+/* Posters are only set when @base_url is, e.g. the one of
+ * totem_mock_source_start_http_server() */
+void
+totem_mock_source_set_poster_url (TotemMockSource *self,
+                                  const gchar     *base_url)
+{
+  g_return_if_fail (TOTEM_IS_MOCK_SOURCE (self));
+
+  g_free (self->priv->poster_url);
+  self->priv->poster_url = g_strdup (base_url);
+}
+
+/* Each reply is delayed by @latency_ms, plus or minus up to @jitter_ms */
+void
+totem_mock_source_set_latency (TotemMockSource *self,
+                               guint            latency_ms,
+                               guint            jitter_ms)
+{
+  g_return_if_fail (TOTEM_IS_MOCK_SOURCE (self));
+
+  self->priv->latency_ms = latency_ms;
+  self->priv->jitter_ms = jitter_ms;
+}
+
+/* Fraction of the requests failing, from 0 to 1 */
+void
+totem_mock_source_set_error_rate (TotemMockSource *self,
+                                  gdouble          error_rate)
+{
+  g_return_if_fail (TOTEM_IS_MOCK_SOURCE (self));
+
+  self->priv->error_rate = CLAMP (error_rate, 0.0, 1.0);
+}
+
+/* Requests over @per_second in a second fail; 0 means no limit */
+void
+totem_mock_source_set_rate_limit (TotemMockSource *self,
+                                  guint            per_second)
+{
+  g_return_if_fail (TOTEM_IS_MOCK_SOURCE (self));
+
+  self->priv->rate_limit = per_second;
+}
+
+guint
+totem_mock_source_get_resolve_count (TotemMockSource *self)
+{
+  g_return_val_if_fail (TOTEM_IS_MOCK_SOURCE (self), 0);
+
+  return self->priv->resolve_count;
+}
+
+guint
+totem_mock_source_get_error_count (TotemMockSource *self)
+{
+  g_return_val_if_fail (TOTEM_IS_MOCK_SOURCE (self), 0);
+
+  return self->priv->error_count;
+}
+
+/* Serve the files of @directory over HTTP on a free port of localhost,
+ * each reply delayed by @latency_ms. @base_url is set to the url of the
+ * directory. Stop it with g_socket_service_stop(). */
+GSocketService *
+totem_mock_source_start_http_server (const gchar  *directory,
+                                     guint         latency_ms,
+                                     gchar       **base_url,
+                                     GError      **error)
+{
+  GSocketService *service;
+  GInetAddress *loopback;
+  GSocketAddress *address, *effective;
+  HttpServer *http;
+  guint16 port;
+
+  g_return_val_if_fail (directory != NULL, NULL);
+  g_return_val_if_fail (base_url != NULL, NULL);
+
+  service = g_threaded_socket_service_new (-1);
+
+  loopback = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  address = g_inet_socket_address_new (loopback, 0);
+  g_object_unref (loopback);
+
+  if (!g_socket_listener_add_address (G_SOCKET_LISTENER (service), address,
+                                      G_SOCKET_TYPE_STREAM, G_SOCKET_PROTOCOL_TCP,
+                                      NULL, &effective, error)) {
+    g_object_unref (address);
+    g_object_unref (service);
+    return NULL;
+  }
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (effective));
+  g_object_unref (effective);
+  g_object_unref (address);
+
+  http = g_slice_new (HttpServer);
+  http->directory = g_strdup (directory);
+  http->latency_ms = latency_ms;
+  g_signal_connect_data (service, "run", G_CALLBACK (http_run), http,
+                         (GClosureNotify) http_server_free, 0);
+
+  g_socket_service_start (service);
+  *base_url = g_strdup_printf ("http://127.0.0.1:%u", port);
+
+  return service;
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_mock_source_finalize (GObject *object)
+{
+  TotemMockSourcePrivate *priv = TOTEM_MOCK_SOURCE (object)->priv;
+
+  g_clear_pointer (&priv->fixtures, g_hash_table_unref);
+  g_clear_pointer (&priv->poster_url, g_free);
+  g_clear_pointer (&priv->rand, g_rand_free);
+
+  G_OBJECT_CLASS (totem_mock_source_parent_class)->finalize (object);
+}
+
+static void
+totem_mock_source_init (TotemMockSource *self)
+{
+  self->priv = totem_mock_source_get_instance_private (self);
+  self->priv->rand = g_rand_new_with_seed (0);
+}
+
+static void
+totem_mock_source_class_init (TotemMockSourceClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+  GrlSourceClass *source_class = GRL_SOURCE_CLASS (class);
+
+  object_class->finalize = totem_mock_source_finalize;
+
+  source_class->supported_keys = totem_mock_source_supported_keys;
+  source_class->may_resolve = totem_mock_source_may_resolve;
+  source_class->resolve = totem_mock_source_resolve;
+}
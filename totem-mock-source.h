@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#ifndef TOTEM_MOCK_SOURCE_H
+#define TOTEM_MOCK_SOURCE_H
+
+#include <gio/gio.h>
+#include <grilo.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_MOCK_SOURCE             (totem_mock_source_get_type())
+
+#define TOTEM_MOCK_SOURCE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_MOCK_SOURCE, TotemMockSource))
+#define TOTEM_MOCK_SOURCE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_MOCK_SOURCE, TotemMockSourceClass))
+#define TOTEM_IS_MOCK_SOURCE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_MOCK_SOURCE))
+#define TOTEM_IS_MOCK_SOURCE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_MOCK_SOURCE))
+#define TOTEM_MOCK_SOURCE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_MOCK_SOURCE, TotemMockSourceClass))
+
+typedef struct _TotemMockSource        TotemMockSource;
+typedef struct _TotemMockSourceClass   TotemMockSourceClass;
+typedef struct _TotemMockSourcePrivate TotemMockSourcePrivate;
+
+struct _TotemMockSource
+{
+  GrlSource parent_instance;
+  TotemMockSourcePrivate *priv;
+};
+
+struct _TotemMockSourceClass
+{
+  GrlSourceClass parent_class;
+};
+
+GType               totem_mock_source_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemMockSource *totem_mock_source_register (const gchar  *source_id,
+                                             GError      **error);
+gboolean totem_mock_source_set_fixtures (TotemMockSource  *self,
+                                         const gchar      *directory,
+                                         GError          **error);
+void totem_mock_source_set_poster_url (TotemMockSource *self,
+                                       const gchar     *base_url);
+void totem_mock_source_set_latency (TotemMockSource *self,
+                                    guint            latency_ms,
+                                    guint            jitter_ms);
+void totem_mock_source_set_error_rate (TotemMockSource *self,
+                                       gdouble          error_rate);
+void totem_mock_source_set_rate_limit (TotemMockSource *self,
+                                       guint            per_second);
+guint totem_mock_source_get_resolve_count (TotemMockSource *self);
+guint totem_mock_source_get_error_count (TotemMockSource *self);
+
+GSocketService *totem_mock_source_start_http_server (const gchar  *directory,
+                                                     guint         latency_ms,
+                                                     gchar       **base_url,
+                                                     GError      **error);
+
+G_END_DECLS
+
+#endif /* TOTEM_MOCK_SOURCE_H */
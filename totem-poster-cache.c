@@ -0,0 +1,1066 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#include "totem-poster-cache.h"
+
+#include <glib/gstdio.h>
+#include <net/grl-net.h>
+#include <string.h>
+
+#include "totem-trace.h"
+
+typedef struct
+{
+  gchar   *key;
+  guint64  size;
+  gint64   mtime;
+  GList   *link;
+} PosterEntry;
+
+typedef struct _TotemPosterCachePrivate
+{
+  gchar   *directory;
+  guint64  max_size;
+  guint64  size;
+
+  /* Hash of the url -> PosterEntry */
+  GHashTable *entries;
+  /* Most recently used first */
+  GQueue      lru;
+
+  /* The directory is scanned in a worker thread, the entries it found
+   * are only added to the index on the main thread, see ensure_loaded() */
+  GMutex    load_lock;
+  GCond     load_cond;
+  gboolean  scanned;
+  GList    *scanned_entries;
+  gboolean  loaded;
+
+  /* Keys of the posters used since their file was last touched */
+  GHashTable *touched;
+  guint       touch_id;
+
+  /* Url -> FetchData of its running download */
+  GHashTable *in_flight;
+  GrlNetWc   *wc;
+
+  guint hits;
+  guint misses;
+  guint coalesced;
+} TotemPosterCachePrivate;
+
+#define DEFAULT_MAX_SIZE (64 * 1024 * 1024)
+
+/* Posters used are touched on disk in batches */
+#define TOUCH_TIMEOUT_SECONDS 5
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemPosterCache, totem_poster_cache, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static void
+poster_entry_free (PosterEntry *entry)
+{
+  g_free (entry->key);
+  g_slice_free (PosterEntry, entry);
+}
+
+/* Posters are content-addressed by their url: two shows with the same
+ * title do not collide and new artwork always lands in a new file */
+static gchar *
+get_key_from_url (const gchar *url)
+{
+  return g_compute_checksum_for_string (G_CHECKSUM_SHA1, url, -1);
+}
+
+#define KEY_LENGTH 40
+
+static gboolean
+has_key_prefix (const gchar *name)
+{
+  gsize i;
+
+  for (i = 0; i < KEY_LENGTH; i++) {
+    if (!g_ascii_isxdigit (name[i]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+is_valid_key (const gchar *name)
+{
+  return strlen (name) == KEY_LENGTH && has_key_prefix (name);
+}
+
+/* g_file_set_contents() writes to "<key>.XXXXXX" before renaming it */
+static gboolean
+is_temp_file (const gchar *name)
+{
+  gsize i;
+
+  if (strlen (name) != KEY_LENGTH + 7 || !has_key_prefix (name) || name[KEY_LENGTH] != '.')
+    return FALSE;
+
+  for (i = KEY_LENGTH + 1; name[i] != '\0'; i++) {
+    if (!g_ascii_isalnum (name[i]))
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static gchar *
+get_path_from_key (TotemPosterCache *self,
+                   const gchar      *key)
+{
+  return g_build_filename (self->priv->directory, key, NULL);
+}
+
+/* Drop @entry from the index only, e.g. its file is gone already */
+static void
+forget_entry (TotemPosterCache *self,
+              PosterEntry      *entry)
+{
+  TotemPosterCachePrivate *priv = self->priv;
+
+  priv->size -= entry->size;
+  g_hash_table_remove (priv->touched, entry->key);
+  g_queue_delete_link (&priv->lru, entry->link);
+  g_hash_table_remove (priv->entries, entry->key);
+}
+
+static void
+remove_entry (TotemPosterCache *self,
+              PosterEntry      *entry)
+{
+  gchar *path;
+
+  path = get_path_from_key (self, entry->key);
+  g_unlink (path);
+  g_free (path);
+
+  forget_entry (self, entry);
+}
+
+/* Drop least recently used posters until we fit in the budget, but never
+ * the most recent one */
+static void
+evict (TotemPosterCache *self)
+{
+  TotemPosterCachePrivate *priv = self->priv;
+
+  while (priv->size > priv->max_size && priv->lru.length > 1) {
+    PosterEntry *entry = g_queue_peek_tail (&priv->lru);
+
+    g_debug ("Poster cache: evicting %s (%" G_GUINT64_FORMAT " bytes)",
+             entry->key, entry->size);
+    remove_entry (self, entry);
+  }
+}
+
+static gint
+compare_entries_by_mtime (gconstpointer a,
+                          gconstpointer b,
+                          gpointer      user_data)
+{
+  const PosterEntry *ea = a;
+  const PosterEntry *eb = b;
+
+  /* Most recent first */
+  return (ea->mtime < eb->mtime) - (ea->mtime > eb->mtime);
+}
+
+/* Rebuild the LRU list from disk; the modification time of each poster is
+ * refreshed when it is used so the order survives restarts. Runs in a
+ * worker thread, the entries found are sorted most recent first. */
+static GList *
+scan_entries (const gchar *directory)
+{
+  const gchar *name;
+  GList *entries = NULL;
+  GDir *dir;
+
+  dir = g_dir_open (directory, 0, NULL);
+  if (dir == NULL)
+    return NULL;
+
+  while ((name = g_dir_read_name (dir)) != NULL) {
+    PosterEntry *entry;
+    GStatBuf st;
+    gchar *path;
+
+    path = g_build_filename (directory, name, NULL);
+    if (is_temp_file (name)) {
+      /* Leftover of an interrupted write */
+      g_unlink (path);
+      g_free (path);
+      continue;
+    }
+
+    /* Not ours, the directory may be shared */
+    if (!is_valid_key (name)) {
+      g_free (path);
+      continue;
+    }
+
+    if (g_stat (path, &st) != 0 || !S_ISREG (st.st_mode)) {
+      g_free (path);
+      continue;
+    }
+    g_free (path);
+
+    entry = g_slice_new0 (PosterEntry);
+    entry->key = g_strdup (name);
+    entry->size = st.st_size;
+    entry->mtime = st.st_mtime;
+    entries = g_list_prepend (entries, entry);
+  }
+  g_dir_close (dir);
+
+  return g_list_sort_with_data (entries, compare_entries_by_mtime, NULL);
+}
+
+static void
+load_thread (GTask        *task,
+             gpointer      source_object,
+             gpointer      task_data,
+             GCancellable *cancellable)
+{
+  TotemPosterCachePrivate *priv = TOTEM_POSTER_CACHE (source_object)->priv;
+  GList *entries;
+
+  entries = scan_entries (priv->directory);
+
+  g_mutex_lock (&priv->load_lock);
+  priv->scanned_entries = entries;
+  priv->scanned = TRUE;
+  g_cond_signal (&priv->load_cond);
+  g_mutex_unlock (&priv->load_lock);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Called before the index is used. It only waits for the scan if it is
+ * still running, usually it is over long before the first lookup. */
+static void
+ensure_loaded (TotemPosterCache *self)
+{
+  TotemPosterCachePrivate *priv = self->priv;
+  GList *entries, *it;
+
+  if (priv->loaded)
+    return;
+
+  g_mutex_lock (&priv->load_lock);
+  while (!priv->scanned)
+    g_cond_wait (&priv->load_cond, &priv->load_lock);
+  entries = priv->scanned_entries;
+  priv->scanned_entries = NULL;
+  g_mutex_unlock (&priv->load_lock);
+
+  /* Posters stored meanwhile are the most recent ones already */
+  for (it = entries; it != NULL; it = it->next) {
+    PosterEntry *entry = it->data;
+
+    if (g_hash_table_contains (priv->entries, entry->key)) {
+      poster_entry_free (entry);
+      continue;
+    }
+
+    g_queue_push_tail (&priv->lru, entry);
+    entry->link = priv->lru.tail;
+    priv->size += entry->size;
+    g_hash_table_insert (priv->entries, entry->key, entry);
+  }
+  g_list_free (entries);
+
+  priv->loaded = TRUE;
+  evict (self);
+}
+
+static void
+load_done (GObject      *source_object,
+           GAsyncResult *res,
+           gpointer      user_data)
+{
+  ensure_loaded (TOTEM_POSTER_CACHE (source_object));
+}
+
+static void
+touch_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  GPtrArray *paths = task_data;
+  guint i;
+
+  for (i = 0; i < paths->len; i++)
+    g_utime (g_ptr_array_index (paths, i), NULL);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Paths of the posters used since the last batch */
+static GPtrArray *
+steal_touched (TotemPosterCache *self)
+{
+  GHashTableIter iter;
+  GPtrArray *paths;
+  const gchar *key;
+
+  paths = g_ptr_array_new_full (g_hash_table_size (self->priv->touched), g_free);
+  g_hash_table_iter_init (&iter, self->priv->touched);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    g_ptr_array_add (paths, get_path_from_key (self, key));
+  g_hash_table_remove_all (self->priv->touched);
+
+  return paths;
+}
+
+static gboolean
+touch_timeout (gpointer user_data)
+{
+  TotemPosterCache *self = user_data;
+  GTask *task;
+
+  self->priv->touch_id = 0;
+
+  task = g_task_new (self, NULL, NULL, NULL);
+  g_task_set_task_data (task, steal_touched (self), (GDestroyNotify) g_ptr_array_unref);
+  g_task_run_in_thread (task, touch_thread);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* The modification time on disk is only the order for the next run, it
+ * is refreshed lazily */
+static void
+touch_entry (TotemPosterCache *self,
+             PosterEntry      *entry)
+{
+  TotemPosterCachePrivate *priv = self->priv;
+
+  g_queue_unlink (&priv->lru, entry->link);
+  g_queue_push_head_link (&priv->lru, entry->link);
+  entry->mtime = g_get_real_time () / G_USEC_PER_SEC;
+
+  g_hash_table_add (priv->touched, g_strdup (entry->key));
+  if (priv->touch_id == 0)
+    priv->touch_id = g_timeout_add_seconds (TOUCH_TIMEOUT_SECONDS, touch_timeout, self);
+}
+
+/* As totem_poster_cache_lookup() but not counted in the stats, for
+ * requests that look up more than one url */
+static gchar *
+lookup_path (TotemPosterCache *self,
+             const gchar      *url)
+{
+  PosterEntry *entry;
+  gchar *key;
+
+  ensure_loaded (self);
+
+  key = get_key_from_url (url);
+  entry = g_hash_table_lookup (self->priv->entries, key);
+  g_free (key);
+
+  if (entry == NULL)
+    return NULL;
+
+  /* Nothing is checked on disk; a poster removed behind our back is
+   * dropped once loading it fails */
+  touch_entry (self, entry);
+  return get_path_from_key (self, entry->key);
+}
+
+static gchar *
+get_path_from_url (TotemPosterCache *self,
+                   const gchar      *url)
+{
+  PosterEntry *entry;
+  gchar *key;
+
+  ensure_loaded (self);
+
+  key = get_key_from_url (url);
+  entry = g_hash_table_lookup (self->priv->entries, key);
+  g_free (key);
+
+  return (entry != NULL) ? get_path_from_key (self, entry->key) : NULL;
+}
+
+/* One download shared by every request of the same url; it is cancelled
+ * once all of them are */
+typedef struct
+{
+  TotemPosterCache *cache;
+  gchar            *url;
+  GCancellable     *cancellable;
+  GList            *waiters;
+  gint64            start;
+} FetchData;
+
+typedef struct
+{
+  FetchData *fd;
+  GTask     *task;
+  gulong     cancelled_id;
+} FetchWaiter;
+
+static void
+fetch_waiter_free (FetchWaiter *w)
+{
+  GCancellable *cancellable = g_task_get_cancellable (w->task);
+
+  if (w->cancelled_id != 0)
+    g_signal_handler_disconnect (cancellable, w->cancelled_id);
+  g_object_unref (w->task);
+  g_slice_free (FetchWaiter, w);
+}
+
+static void
+fetch_waiter_cancelled_cb (GCancellable *cancellable,
+                           FetchWaiter  *w)
+{
+  FetchData *fd = w->fd;
+
+  fd->waiters = g_list_remove (fd->waiters, w);
+  g_task_return_error_if_cancelled (w->task);
+  fetch_waiter_free (w);
+
+  if (fd->waiters != NULL)
+    return;
+
+  /* Nobody wants this poster anymore, a new request starts over */
+  g_hash_table_remove (fd->cache->priv->in_flight, fd->url);
+  g_cancellable_cancel (fd->cancellable);
+}
+
+static void
+fetch_add_waiter (FetchData *fd,
+                  GTask     *task)
+{
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  FetchWaiter *w;
+
+  w = g_slice_new0 (FetchWaiter);
+  w->fd = fd;
+  w->task = task;
+  if (cancellable != NULL)
+    w->cancelled_id = g_signal_connect (cancellable, "cancelled",
+                                        G_CALLBACK (fetch_waiter_cancelled_cb), w);
+  fd->waiters = g_list_prepend (fd->waiters, w);
+}
+
+/* Every episode that asked for this poster meanwhile is completed here */
+static void
+fetch_complete (FetchData    *fd,
+                const gchar  *path,
+                const GError *err)
+{
+  TotemPosterCache *self = fd->cache;
+  GList *waiters, *it;
+
+  if (g_hash_table_lookup (self->priv->in_flight, fd->url) == fd)
+    g_hash_table_remove (self->priv->in_flight, fd->url);
+
+  waiters = g_list_reverse (fd->waiters);
+  fd->waiters = NULL;
+  for (it = waiters; it != NULL; it = it->next) {
+    FetchWaiter *w = it->data;
+
+    if (path != NULL)
+      g_task_return_pointer (w->task, g_strdup (path), g_free);
+    else
+      g_task_return_error (w->task, g_error_copy (err));
+    fetch_waiter_free (w);
+  }
+
+  g_list_free (waiters);
+  g_free (fd->url);
+  g_object_unref (fd->cancellable);
+  g_object_unref (fd->cache);
+  g_slice_free (FetchData, fd);
+}
+
+static void
+fetch_stored (GObject      *source_object,
+              GAsyncResult *res,
+              gpointer      user_data)
+{
+  FetchData *fd = user_data;
+  GError *err = NULL;
+  gchar *path;
+
+  path = totem_poster_cache_store_finish (TOTEM_POSTER_CACHE (source_object), res, &err);
+  fetch_complete (fd, path, err);
+  g_clear_error (&err);
+  g_free (path);
+}
+
+static void
+fetch_done (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  FetchData *fd = user_data;
+  GBytes *bytes;
+  GError *err = NULL;
+  gchar *data;
+  gsize len;
+
+  totem_trace_span ("poster-download", fd->start, g_get_monotonic_time (), fd->url);
+
+  if (!grl_net_wc_request_finish (GRL_NET_WC (source_object), res, &data, &len, &err)) {
+    fetch_complete (fd, NULL, err);
+    g_error_free (err);
+    return;
+  }
+
+  /* Requests of the url keep joining this one until it is written */
+  bytes = g_bytes_new (data, len);
+  totem_poster_cache_store_async (fd->cache, fd->url, bytes, NULL, fetch_stored, fd);
+  g_bytes_unref (bytes);
+}
+
+/* The poster is written in a worker thread; the cache itself is only
+ * updated from the main thread once it is on disk */
+typedef struct
+{
+  gchar  *url;
+  gchar  *key;
+  gchar  *path;
+  GBytes *bytes;
+} StoreData;
+
+static void
+store_data_free (StoreData *sd)
+{
+  g_free (sd->url);
+  g_free (sd->key);
+  g_free (sd->path);
+  g_bytes_unref (sd->bytes);
+  g_slice_free (StoreData, sd);
+}
+
+static void
+store_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  StoreData *sd = task_data;
+  GError *err = NULL;
+  gconstpointer data;
+  gint64 start;
+  gsize len;
+
+  /* g_file_set_contents() writes to a temporary file and renames it */
+  data = g_bytes_get_data (sd->bytes, &len);
+  start = g_get_monotonic_time ();
+  if (!g_file_set_contents (sd->path, data, len, &err)) {
+    g_task_return_error (task, err);
+    return;
+  }
+  totem_trace_span ("poster-write", start, g_get_monotonic_time (), sd->url);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+static void
+store_done (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  TotemPosterCache *self = TOTEM_POSTER_CACHE (source_object);
+  TotemPosterCachePrivate *priv = self->priv;
+  GTask *task = user_data;
+  PosterEntry *entry;
+  StoreData *sd;
+  GError *err = NULL;
+  gsize len;
+
+  if (!g_task_propagate_boolean (G_TASK (res), &err)) {
+    g_task_return_error (task, err);
+    g_object_unref (task);
+    return;
+  }
+
+  sd = g_task_get_task_data (G_TASK (res));
+  len = g_bytes_get_size (sd->bytes);
+  ensure_loaded (self);
+  entry = g_hash_table_lookup (priv->entries, sd->key);
+  if (entry != NULL) {
+    priv->size -= entry->size;
+    g_queue_unlink (&priv->lru, entry->link);
+  } else {
+    entry = g_slice_new0 (PosterEntry);
+    entry->key = g_strdup (sd->key);
+    entry->link = g_list_alloc ();
+    entry->link->data = entry;
+    g_hash_table_insert (priv->entries, entry->key, entry);
+  }
+
+  entry->size = len;
+  entry->mtime = g_get_real_time () / G_USEC_PER_SEC;
+  priv->size += len;
+  g_queue_push_head_link (&priv->lru, entry->link);
+
+  evict (self);
+
+  g_task_return_pointer (task, g_strdup (sd->path), g_free);
+  g_object_unref (task);
+}
+
+/* Posters scaled to a given size are cached as PNG under their own key */
+typedef struct
+{
+  gchar    *path;
+  gboolean  scaled;
+  gint      width;
+  gint      height;
+
+  gchar    *scaled_url;
+  gchar    *buffer;
+  gsize     len;
+} ScaleData;
+
+static void
+scale_data_free (ScaleData *sd)
+{
+  g_free (sd->path);
+  g_free (sd->scaled_url);
+  g_free (sd->buffer);
+  g_slice_free (ScaleData, sd);
+}
+
+static gchar *
+get_scaled_url (const gchar *url,
+                gint         width,
+                gint         height)
+{
+  return g_strdup_printf ("%s#%dx%d", url, width, height);
+}
+
+/* Decoding and scaling a full size poster takes a while, keep it out of the
+ * main thread */
+static void
+scale_thread (GTask        *task,
+              gpointer      source_object,
+              gpointer      task_data,
+              GCancellable *cancellable)
+{
+  ScaleData *sd = task_data;
+  GdkPixbuf *pixbuf;
+  GError *err = NULL;
+
+  if (sd->scaled)
+    pixbuf = gdk_pixbuf_new_from_file (sd->path, &err);
+  else
+    pixbuf = gdk_pixbuf_new_from_file_at_scale (sd->path, sd->width, sd->height, TRUE, &err);
+
+  if (pixbuf == NULL) {
+    g_task_return_error (task, err);
+    return;
+  }
+
+  if (!sd->scaled &&
+      !gdk_pixbuf_save_to_buffer (pixbuf, &sd->buffer, &sd->len, "png", &err, NULL)) {
+    g_debug ("Failed to encode scaled poster: %s", err->message);
+    g_clear_error (&err);
+  }
+
+  g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+static void
+scaled_stored (GObject      *source_object,
+               GAsyncResult *res,
+               gpointer      user_data)
+{
+  GError *err = NULL;
+  gchar *path;
+
+  path = totem_poster_cache_store_finish (TOTEM_POSTER_CACHE (source_object), res, &err);
+  if (path == NULL) {
+    g_debug ("Failed to cache scaled poster: %s", err->message);
+    g_error_free (err);
+  }
+  g_free (path);
+}
+
+static void
+forget_path (TotemPosterCache *self,
+             const gchar      *path)
+{
+  PosterEntry *entry;
+  gchar *key;
+
+  key = g_path_get_basename (path);
+  entry = g_hash_table_lookup (self->priv->entries, key);
+  if (entry != NULL)
+    forget_entry (self, entry);
+  g_free (key);
+}
+
+static void
+scale_done (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  TotemPosterCache *self = TOTEM_POSTER_CACHE (source_object);
+  GTask *task = user_data;
+  ScaleData *sd;
+  GdkPixbuf *pixbuf;
+  GError *err = NULL;
+
+  sd = g_task_get_task_data (G_TASK (res));
+  pixbuf = g_task_propagate_pointer (G_TASK (res), &err);
+  if (pixbuf == NULL) {
+    /* Removed behind our back */
+    if (g_error_matches (err, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+      forget_path (self, sd->path);
+    g_task_return_error (task, err);
+    g_object_unref (task);
+    return;
+  }
+
+  if (sd->buffer != NULL) {
+    GBytes *bytes;
+
+    bytes = g_bytes_new_take (sd->buffer, sd->len);
+    sd->buffer = NULL;
+    totem_poster_cache_store_async (self, sd->scaled_url, bytes, NULL, scaled_stored, NULL);
+    g_bytes_unref (bytes);
+  }
+
+  g_task_return_pointer (task, pixbuf, g_object_unref);
+  g_object_unref (task);
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* @directory defaults to a folder in the user's cache directory and
+ * @max_size, in bytes, to 64 MiB when 0 */
+TotemPosterCache *
+totem_poster_cache_new (const gchar *directory,
+                        guint64      max_size)
+{
+  TotemPosterCache *self;
+  TotemPosterCachePrivate *priv;
+  GTask *task;
+
+  self = g_object_new (TOTEM_TYPE_POSTER_CACHE, NULL);
+  priv = self->priv;
+
+  if (directory != NULL)
+    priv->directory = g_strdup (directory);
+  else
+    priv->directory = g_build_filename (g_get_user_cache_dir (),
+                                        "totem-series",
+                                        "posters",
+                                        NULL);
+  priv->max_size = (max_size > 0) ? max_size : DEFAULT_MAX_SIZE;
+
+  if (g_mkdir_with_parents (priv->directory, 0700) != 0)
+    g_warning ("Failed to create poster cache at %s", priv->directory);
+
+  task = g_task_new (self, NULL, load_done, NULL);
+  g_task_run_in_thread (task, load_thread);
+  g_object_unref (task);
+
+  return self;
+}
+
+/* Returns the path of the poster of @url or NULL if it is not cached */
+gchar *
+totem_poster_cache_lookup (TotemPosterCache *self,
+                           const gchar      *url)
+{
+  gchar *path;
+
+  g_return_val_if_fail (TOTEM_IS_POSTER_CACHE (self), NULL);
+  g_return_val_if_fail (url != NULL, NULL);
+
+  path = lookup_path (self, url);
+  if (path != NULL)
+    self->priv->hits++;
+  else
+    self->priv->misses++;
+
+  return path;
+}
+
+/* Atomically writes the poster of @url into the cache, evicting older
+ * posters if the cache grows over its budget. The file is written in a
+ * worker thread. */
+void
+totem_poster_cache_store_async (TotemPosterCache    *self,
+                                const gchar         *url,
+                                GBytes              *data,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  GTask *task, *store_task;
+  StoreData *sd;
+
+  g_return_if_fail (TOTEM_IS_POSTER_CACHE (self));
+  g_return_if_fail (url != NULL);
+  g_return_if_fail (data != NULL);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+
+  sd = g_slice_new0 (StoreData);
+  sd->url = g_strdup (url);
+  sd->key = get_key_from_url (url);
+  sd->path = get_path_from_key (self, sd->key);
+  sd->bytes = g_bytes_ref (data);
+
+  /* Once started the write completes, a poster on disk is never wasted */
+  store_task = g_task_new (self, NULL, store_done, task);
+  g_task_set_task_data (store_task, sd, (GDestroyNotify) store_data_free);
+  g_task_run_in_thread (store_task, store_thread);
+  g_object_unref (store_task);
+}
+
+/* Returns the path of the stored poster */
+gchar *
+totem_poster_cache_store_finish (TotemPosterCache  *self,
+                                 GAsyncResult      *res,
+                                 GError           **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/* Download the poster at @url into the cache. Concurrent requests for the
+ * same url share a single download, which is only cancelled together with
+ * the last of them. */
+void
+totem_poster_cache_fetch_async (TotemPosterCache    *self,
+                                const gchar         *url,
+                                GCancellable        *cancellable,
+                                GAsyncReadyCallback  callback,
+                                gpointer             user_data)
+{
+  TotemPosterCachePrivate *priv;
+  FetchData *fd;
+  GTask *task;
+  gchar *path;
+
+  g_return_if_fail (TOTEM_IS_POSTER_CACHE (self));
+  g_return_if_fail (url != NULL);
+
+  priv = self->priv;
+  task = g_task_new (self, cancellable, callback, user_data);
+  if (g_task_return_error_if_cancelled (task)) {
+    g_object_unref (task);
+    return;
+  }
+
+  fd = g_hash_table_lookup (priv->in_flight, url);
+  if (fd != NULL) {
+    priv->coalesced++;
+    fetch_add_waiter (fd, task);
+    return;
+  }
+
+  path = get_path_from_url (self, url);
+  if (path != NULL) {
+    g_task_return_pointer (task, path, g_free);
+    g_object_unref (task);
+    return;
+  }
+
+  fd = g_slice_new0 (FetchData);
+  fd->cache = g_object_ref (self);
+  fd->url = g_strdup (url);
+  fd->cancellable = g_cancellable_new ();
+  fd->start = g_get_monotonic_time ();
+  fetch_add_waiter (fd, task);
+  g_hash_table_insert (priv->in_flight, g_strdup (url), fd);
+
+  grl_net_wc_request_async (priv->wc, url, fd->cancellable, fetch_done, fd);
+}
+
+/* Returns the path of the downloaded poster */
+gchar *
+totem_poster_cache_fetch_finish (TotemPosterCache  *self,
+                                 GAsyncResult      *res,
+                                 GError           **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/* Returns the poster of @url, that must be in the cache already, decoded
+ * and scaled to fit in @width x @height. Both are done in a worker thread
+ * and the scaled poster is cached as well. */
+void
+totem_poster_cache_load_scaled_async (TotemPosterCache    *self,
+                                      const gchar         *url,
+                                      gint                 width,
+                                      gint                 height,
+                                      GCancellable        *cancellable,
+                                      GAsyncReadyCallback  callback,
+                                      gpointer             user_data)
+{
+  GTask *task, *scale_task;
+  ScaleData *sd;
+
+  g_return_if_fail (TOTEM_IS_POSTER_CACHE (self));
+  g_return_if_fail (url != NULL);
+  g_return_if_fail (width > 0 && height > 0);
+
+  task = g_task_new (self, cancellable, callback, user_data);
+
+  sd = g_slice_new0 (ScaleData);
+  sd->width = width;
+  sd->height = height;
+  sd->scaled_url = get_scaled_url (url, width, height);
+  sd->path = lookup_path (self, sd->scaled_url);
+  sd->scaled = (sd->path != NULL);
+  if (sd->path == NULL)
+    sd->path = lookup_path (self, url);
+
+  /* One request, counted once whichever of both was found */
+  if (sd->path != NULL)
+    self->priv->hits++;
+  else
+    self->priv->misses++;
+
+  if (sd->path == NULL) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                             "Poster of %s is not in the cache", url);
+    g_object_unref (task);
+    scale_data_free (sd);
+    return;
+  }
+
+  scale_task = g_task_new (self, cancellable, scale_done, task);
+  g_task_set_task_data (scale_task, sd, (GDestroyNotify) scale_data_free);
+  g_task_run_in_thread (scale_task, scale_thread);
+  g_object_unref (scale_task);
+}
+
+GdkPixbuf *
+totem_poster_cache_load_scaled_finish (TotemPosterCache  *self,
+                                       GAsyncResult      *res,
+                                       GError           **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+void
+totem_poster_cache_get_stats (TotemPosterCache *self,
+                              guint            *hits,
+                              guint            *misses,
+                              guint            *coalesced,
+                              guint64          *size)
+{
+  g_return_if_fail (TOTEM_IS_POSTER_CACHE (self));
+
+  if (hits != NULL)
+    *hits = self->priv->hits;
+  if (misses != NULL)
+    *misses = self->priv->misses;
+  if (coalesced != NULL)
+    *coalesced = self->priv->coalesced;
+  if (size != NULL) {
+    ensure_loaded (self);
+    *size = self->priv->size;
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_poster_cache_finalize (GObject *object)
+{
+  TotemPosterCachePrivate *priv = TOTEM_POSTER_CACHE (object)->priv;
+
+  g_debug ("Poster cache: %u hits, %u misses, %u coalesced, %" G_GUINT64_FORMAT " bytes",
+           priv->hits, priv->misses, priv->coalesced, priv->size);
+
+  /* Posters used since the last batch are touched right away */
+  if (priv->touch_id != 0) {
+    GPtrArray *paths = steal_touched (TOTEM_POSTER_CACHE (object));
+    guint i;
+
+    g_source_remove (priv->touch_id);
+    for (i = 0; i < paths->len; i++)
+      g_utime (g_ptr_array_index (paths, i), NULL);
+    g_ptr_array_unref (paths);
+  }
+
+  /* Downloads and the scan of the directory hold a reference on the cache */
+  g_warn_if_fail (g_hash_table_size (priv->in_flight) == 0);
+  g_clear_pointer (&priv->in_flight, g_hash_table_unref);
+  g_clear_object (&priv->wc);
+  g_clear_pointer (&priv->entries, g_hash_table_unref);
+  g_list_free (priv->lru.head);
+  g_queue_init (&priv->lru);
+  g_list_free_full (priv->scanned_entries, (GDestroyNotify) poster_entry_free);
+  g_clear_pointer (&priv->touched, g_hash_table_unref);
+  g_mutex_clear (&priv->load_lock);
+  g_cond_clear (&priv->load_cond);
+  g_clear_pointer (&priv->directory, g_free);
+
+  G_OBJECT_CLASS (totem_poster_cache_parent_class)->finalize (object);
+}
+
+static void
+totem_poster_cache_init (TotemPosterCache *self)
+{
+  self->priv = totem_poster_cache_get_instance_private (self);
+  self->priv->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                               (GDestroyNotify) poster_entry_free);
+  g_queue_init (&self->priv->lru);
+  g_mutex_init (&self->priv->load_lock);
+  g_cond_init (&self->priv->load_cond);
+  self->priv->touched = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  self->priv->in_flight = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  self->priv->wc = grl_net_wc_new ();
+}
+
+static void
+totem_poster_cache_class_init (TotemPosterCacheClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = totem_poster_cache_finalize;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_POSTER_CACHE_H
+#define TOTEM_POSTER_CACHE_H
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_POSTER_CACHE             (totem_poster_cache_get_type())
+
+#define TOTEM_POSTER_CACHE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_POSTER_CACHE, TotemPosterCache))
+#define TOTEM_POSTER_CACHE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_POSTER_CACHE, TotemPosterCacheClass))
+#define TOTEM_IS_POSTER_CACHE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_POSTER_CACHE))
+#define TOTEM_IS_POSTER_CACHE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_POSTER_CACHE))
+#define TOTEM_POSTER_CACHE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_POSTER_CACHE, TotemPosterCacheClass))
+
+typedef struct _TotemPosterCache        TotemPosterCache;
+typedef struct _TotemPosterCacheClass   TotemPosterCacheClass;
+typedef struct _TotemPosterCachePrivate TotemPosterCachePrivate;
+
+struct _TotemPosterCache
+{
+  GObject parent_instance;
+  TotemPosterCachePrivate *priv;
+};
+
+struct _TotemPosterCacheClass
+{
+  GObjectClass parent_class;
+};
+
+GType               totem_poster_cache_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemPosterCache *totem_poster_cache_new (const gchar *directory,
+                                          guint64      max_size);
+gchar *totem_poster_cache_lookup (TotemPosterCache *self,
+                                  const gchar      *url);
+void totem_poster_cache_store_async (TotemPosterCache    *self,
+                                     const gchar         *url,
+                                     GBytes              *data,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+gchar *totem_poster_cache_store_finish (TotemPosterCache  *self,
+                                        GAsyncResult      *res,
+                                        GError           **error);
+void totem_poster_cache_fetch_async (TotemPosterCache    *self,
+                                     const gchar         *url,
+                                     GCancellable        *cancellable,
+                                     GAsyncReadyCallback  callback,
+                                     gpointer             user_data);
+gchar *totem_poster_cache_fetch_finish (TotemPosterCache  *self,
+                                        GAsyncResult      *res,
+                                        GError           **error);
+void totem_poster_cache_load_scaled_async (TotemPosterCache    *self,
+                                           const gchar         *url,
+                                           gint                 width,
+                                           gint                 height,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+GdkPixbuf *totem_poster_cache_load_scaled_finish (TotemPosterCache  *self,
+                                                  GAsyncResult      *res,
+                                                  GError           **error);
+void totem_poster_cache_get_stats (TotemPosterCache *self,
+                                   guint            *hits,
+                                   guint            *misses,
+                                   guint            *coalesced,
+                                   guint64          *size);
+
+G_END_DECLS
+
+#endif /* TOTEM_POSTER_CACHE_H */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#include "totem-scheduler.h"
+
+/* Operations are limited per resource, usually a GrlSource */
+typedef struct
+{
+  guint  max_in_flight;
+  guint  in_flight;
+  GQueue queues[TOTEM_SCHEDULER_N_PRIORITIES];
+} Resource;
+
+typedef struct
+{
+  TotemSchedulerFunc      func;
+  gpointer                user_data;
+  gint                    group;
+  Resource               *resource;
+  TotemSchedulerPriority  priority;
+} Job;
+
+typedef struct _TotemSchedulerPrivate
+{
+  GHashTable *resources;
+  /* user_data -> GList link of its queued Job */
+  GHashTable *jobs;
+  guint       max_in_flight;
+} TotemSchedulerPrivate;
+
+#define DEFAULT_MAX_IN_FLIGHT 4
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemScheduler, totem_scheduler, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static void
+job_free (Job *job)
+{
+  g_slice_free (Job, job);
+}
+
+static void
+resource_free (Resource *r)
+{
+  guint i;
+
+  for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++) {
+    Job *job;
+
+    while ((job = g_queue_pop_head (&r->queues[i])) != NULL)
+      job_free (job);
+  }
+  g_slice_free (Resource, r);
+}
+
+static Resource *
+get_resource (TotemScheduler *self,
+              gconstpointer   resource)
+{
+  Resource *r;
+  guint i;
+
+  r = g_hash_table_lookup (self->priv->resources, resource);
+  if (r != NULL)
+    return r;
+
+  r = g_slice_new0 (Resource);
+  r->max_in_flight = self->priv->max_in_flight;
+  for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++)
+    g_queue_init (&r->queues[i]);
+  g_hash_table_insert (self->priv->resources, (gpointer) resource, r);
+
+  return r;
+}
+
+static Job *
+pop_job (TotemScheduler *self,
+         Resource       *r)
+{
+  guint i;
+
+  for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++) {
+    if (!g_queue_is_empty (&r->queues[i])) {
+      Job *job = g_queue_pop_head (&r->queues[i]);
+
+      g_hash_table_remove (self->priv->jobs, job->user_data);
+      return job;
+    }
+  }
+  return NULL;
+}
+
+/* Start queued operations while there are free slots. Operations might call
+ * totem_scheduler_done() right away which is fine. */
+static void
+dispatch (TotemScheduler *self,
+          Resource       *r)
+{
+  while (r->in_flight < r->max_in_flight) {
+    Job *job = pop_job (self, r);
+
+    if (job == NULL)
+      return;
+
+    r->in_flight++;
+    job->func (job->user_data);
+    job_free (job);
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* @max_in_flight is the default limit of simultaneous operations for each
+ * resource; 0 means the default of 4 */
+TotemScheduler *
+totem_scheduler_new (guint max_in_flight)
+{
+  TotemScheduler *self;
+
+  self = g_object_new (TOTEM_TYPE_SCHEDULER, NULL);
+  if (max_in_flight > 0)
+    self->priv->max_in_flight = max_in_flight;
+
+  return self;
+}
+
+void
+totem_scheduler_set_max_in_flight (TotemScheduler *self,
+                                   gconstpointer   resource,
+                                   guint           max_in_flight)
+{
+  Resource *r;
+
+  g_return_if_fail (TOTEM_IS_SCHEDULER (self));
+  g_return_if_fail (max_in_flight > 0);
+
+  r = get_resource (self, resource);
+  r->max_in_flight = max_in_flight;
+  dispatch (self, r);
+}
+
+/* Run @func as soon as @resource has a free slot. Operations of the same
+ * @group, e.g. a season, can be reprioritized together later on.
+ * @user_data identifies the operation for totem_scheduler_cancel(). */
+void
+totem_scheduler_push (TotemScheduler         *self,
+                      gconstpointer           resource,
+                      TotemSchedulerPriority  priority,
+                      gint                    group,
+                      TotemSchedulerFunc      func,
+                      gpointer                user_data)
+{
+  Resource *r;
+  Job *job;
+
+  g_return_if_fail (TOTEM_IS_SCHEDULER (self));
+  g_return_if_fail (priority < TOTEM_SCHEDULER_N_PRIORITIES);
+  g_return_if_fail (func != NULL);
+
+  r = get_resource (self, resource);
+
+  job = g_slice_new (Job);
+  job->func = func;
+  job->user_data = user_data;
+  job->group = group;
+  job->resource = r;
+  job->priority = priority;
+  g_queue_push_tail (&r->queues[priority], job);
+  g_hash_table_insert (self->priv->jobs, user_data, r->queues[priority].tail);
+
+  dispatch (self, r);
+}
+
+/* One operation on @resource is over, start the next one */
+void
+totem_scheduler_done (TotemScheduler *self,
+                      gconstpointer   resource)
+{
+  Resource *r;
+
+  g_return_if_fail (TOTEM_IS_SCHEDULER (self));
+
+  r = g_hash_table_lookup (self->priv->resources, resource);
+  g_return_if_fail (r != NULL && r->in_flight > 0);
+
+  r->in_flight--;
+  dispatch (self, r);
+}
+
+/* Drop the operation of @user_data if it did not start yet. Returns FALSE
+ * if it is not queued, e.g. it is running already. */
+gboolean
+totem_scheduler_cancel (TotemScheduler *self,
+                        gpointer        user_data)
+{
+  GList *link;
+  Job *job;
+
+  g_return_val_if_fail (TOTEM_IS_SCHEDULER (self), FALSE);
+
+  link = g_hash_table_lookup (self->priv->jobs, user_data);
+  if (link == NULL)
+    return FALSE;
+
+  g_hash_table_remove (self->priv->jobs, user_data);
+  job = link->data;
+  g_queue_delete_link (&job->resource->queues[job->priority], link);
+  job_free (job);
+
+  return TRUE;
+}
+
+/* Operations of @resource waiting for a slot */
+guint
+totem_scheduler_get_queued (TotemScheduler *self,
+                            gconstpointer   resource)
+{
+  Resource *r;
+  guint i, queued;
+
+  g_return_val_if_fail (TOTEM_IS_SCHEDULER (self), 0);
+
+  r = g_hash_table_lookup (self->priv->resources, resource);
+  if (r == NULL)
+    return 0;
+
+  queued = 0;
+  for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++)
+    queued += g_queue_get_length (&r->queues[i]);
+  return queued;
+}
+
+guint
+totem_scheduler_get_in_flight (TotemScheduler *self,
+                               gconstpointer   resource)
+{
+  Resource *r;
+
+  g_return_val_if_fail (TOTEM_IS_SCHEDULER (self), 0);
+
+  r = g_hash_table_lookup (self->priv->resources, resource);
+  return (r != NULL) ? r->in_flight : 0;
+}
+
+/* Move the queued operations of @group to @priority, keeping their order */
+void
+totem_scheduler_reprioritize (TotemScheduler         *self,
+                              gint                    group,
+                              TotemSchedulerPriority  priority)
+{
+  GHashTableIter iter;
+  Resource *r;
+
+  g_return_if_fail (TOTEM_IS_SCHEDULER (self));
+  g_return_if_fail (priority < TOTEM_SCHEDULER_N_PRIORITIES);
+
+  g_hash_table_iter_init (&iter, self->priv->resources);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &r)) {
+    guint i;
+
+    for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++) {
+      GList *it;
+
+      if (i == priority)
+        continue;
+
+      it = r->queues[i].head;
+      while (it != NULL) {
+        GList *next = it->next;
+        Job *job = it->data;
+
+        if (job->group == group) {
+          g_queue_unlink (&r->queues[i], it);
+          g_queue_push_tail_link (&r->queues[priority], it);
+          job->priority = priority;
+        }
+        it = next;
+      }
+    }
+  }
+}
+
+/* Ask @func the priority of every queued job, in a single pass over the
+ * queues however many groups change */
+void
+totem_scheduler_reprioritize_all (TotemScheduler             *self,
+                                  TotemSchedulerPriorityFunc  func,
+                                  gpointer                    user_data)
+{
+  GHashTableIter iter;
+  Resource *r;
+
+  g_return_if_fail (TOTEM_IS_SCHEDULER (self));
+  g_return_if_fail (func != NULL);
+
+  g_hash_table_iter_init (&iter, self->priv->resources);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &r)) {
+    guint i;
+
+    for (i = 0; i < TOTEM_SCHEDULER_N_PRIORITIES; i++) {
+      GList *it;
+
+      it = r->queues[i].head;
+      while (it != NULL) {
+        GList *next = it->next;
+        Job *job = it->data;
+        TotemSchedulerPriority priority;
+
+        priority = func (job->group, i, user_data);
+        if (priority != i && priority < TOTEM_SCHEDULER_N_PRIORITIES) {
+          g_queue_unlink (&r->queues[i], it);
+          g_queue_push_tail_link (&r->queues[priority], it);
+          job->priority = priority;
+        }
+        it = next;
+      }
+    }
+  }
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_scheduler_finalize (GObject *object)
+{
+  TotemSchedulerPrivate *priv = TOTEM_SCHEDULER (object)->priv;
+
+  g_clear_pointer (&priv->jobs, g_hash_table_unref);
+  g_clear_pointer (&priv->resources, g_hash_table_unref);
+
+  G_OBJECT_CLASS (totem_scheduler_parent_class)->finalize (object);
+}
+
+static void
+totem_scheduler_init (TotemScheduler *self)
+{
+  self->priv = totem_scheduler_get_instance_private (self);
+  self->priv->resources = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                                 (GDestroyNotify) resource_free);
+  self->priv->jobs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->priv->max_in_flight = DEFAULT_MAX_IN_FLIGHT;
+}
+
+static void
+totem_scheduler_class_init (TotemSchedulerClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = totem_scheduler_finalize;
+}
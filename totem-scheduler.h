@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_SCHEDULER_H
+#define TOTEM_SCHEDULER_H
+
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_SCHEDULER             (totem_scheduler_get_type())
+
+#define TOTEM_SCHEDULER(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_SCHEDULER, TotemScheduler))
+#define TOTEM_SCHEDULER_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_SCHEDULER, TotemSchedulerClass))
+#define TOTEM_IS_SCHEDULER(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_SCHEDULER))
+#define TOTEM_IS_SCHEDULER_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_SCHEDULER))
+#define TOTEM_SCHEDULER_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_SCHEDULER, TotemSchedulerClass))
+
+typedef struct _TotemScheduler        TotemScheduler;
+typedef struct _TotemSchedulerClass   TotemSchedulerClass;
+typedef struct _TotemSchedulerPrivate TotemSchedulerPrivate;
+
+struct _TotemScheduler
+{
+  GObject parent_instance;
+  TotemSchedulerPrivate *priv;
+};
+
+struct _TotemSchedulerClass
+{
+  GObjectClass parent_class;
+};
+
+/* From the most to the least urgent */
+typedef enum
+{
+  TOTEM_SCHEDULER_PRIORITY_VISIBLE,
+  TOTEM_SCHEDULER_PRIORITY_DEFAULT,
+  TOTEM_SCHEDULER_PRIORITY_PREFETCH,
+  TOTEM_SCHEDULER_N_PRIORITIES
+} TotemSchedulerPriority;
+
+/* Starts an operation; totem_scheduler_done() must be called once it is
+ * over */
+typedef void (*TotemSchedulerFunc) (gpointer user_data);
+
+/* New priority of a job of @group queued with @priority */
+typedef TotemSchedulerPriority (*TotemSchedulerPriorityFunc) (gint                   group,
+                                                              TotemSchedulerPriority priority,
+                                                              gpointer               user_data);
+
+#define TOTEM_SCHEDULER_NO_GROUP -1
+
+GType               totem_scheduler_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemScheduler *totem_scheduler_new (guint max_in_flight);
+void totem_scheduler_set_max_in_flight (TotemScheduler *self,
+                                        gconstpointer   resource,
+                                        guint           max_in_flight);
+void totem_scheduler_push (TotemScheduler         *self,
+                           gconstpointer           resource,
+                           TotemSchedulerPriority  priority,
+                           gint                    group,
+                           TotemSchedulerFunc      func,
+                           gpointer                user_data);
+void totem_scheduler_done (TotemScheduler *self,
+                           gconstpointer   resource);
+gboolean totem_scheduler_cancel (TotemScheduler *self,
+                                 gpointer        user_data);
+guint totem_scheduler_get_queued (TotemScheduler *self,
+                                  gconstpointer   resource);
+guint totem_scheduler_get_in_flight (TotemScheduler *self,
+                                     gconstpointer   resource);
+void totem_scheduler_reprioritize (TotemScheduler         *self,
+                                   gint                    group,
+                                   TotemSchedulerPriority  priority);
+void totem_scheduler_reprioritize_all (TotemScheduler             *self,
+                                       TotemSchedulerPriorityFunc  func,
+                                       gpointer                    user_data);
+
+G_END_DECLS
+
+#endif /* TOTEM_SCHEDULER_H */
@@ -25,7 +25,14 @@
 #include <net/grl-net.h>
 #include <string.h>
 
+#include "totem-hash-pool.h"
+#include "totem-metadata-cache.h"
+#include "totem-poster-cache.h"
+#include "totem-scheduler.h"
 #include "totem-series-view.h"
+#include "totem-subtitle-cache.h"
+#include "totem-title-parser.h"
+#include "totem-trace.h"
 
 typedef struct _TotemSeriesSummaryPrivate
 {
@@ -38,48 +45,200 @@ typedef struct _TotemSeriesSummaryPrivate
   GrlKeyID tmdb_poster_key;
   GrlKeyID subtitles_lang_key;
   GrlKeyID subtitles_url_key;
+  GrlKeyID gibest_hash_key;
+
+  GtkStack *views;
+  GtkWidget *sidebar;
+  guint n_views;
+  TotemMetadataCache *metadata_cache;
+  TotemPosterCache *poster_cache;
+  TotemSubtitleCache *subtitle_cache;
+  TotemHashPool *hash_pool;
+
+  /* Url -> OperationSpec of the videos being resolved, and of the videos
+   * shown from stale cached data being resolved again */
+  GHashTable *operations;
+  GHashTable *revalidations;
+  gboolean cache_first;
+
+  /* Subtitles are only looked up once a row asks for them. Url ->
+   * OperationSpec of the lookups running, and url -> (language ->
+   * subtitle url) of the ones done. */
+  GHashTable *subtitle_lookups;
+  GHashTable *subtitles;
+
+  /* Of the subtitle downloads picked by the user */
+  GCancellable *subtitle_cancellable;
+
+  /* ScanData of the directories being walked */
+  GList *scans;
+
+  /* Watch mode: GFile -> GFileMonitor of the library directories, and the
+   * files changed since the last burst of events */
+  gboolean watch;
+  GHashTable *monitors;
+  GHashTable *pending_added;
+  GHashTable *pending_removed;
+  GCancellable *watch_cancellable;
+  guint watch_flush_id;
+
+  /* Limits grilo operations per source, visible season first */
+  TotemScheduler *scheduler;
+  struct _ShowData *visible_show;
+  gint visible_season;
+  /* Asked for while no show was visible, applied to the next one */
+  gint pending_season;
+
+  /* Normalized show name -> ShowData */
+  GHashTable *shows;
+  GList *series_keys;
+  GList *episode_keys;
+  gboolean bulk_fetch;
+
+  TotemSeriesSummaryStageStats stage_stats[TOTEM_SERIES_SUMMARY_N_STAGES];
+
+  /* Videos ready to be shown, flushed to the views from the frame clock
+   * before the layout, their shows and since when they wait. A summary
+   * that is not mapped has no frame clock running, an idle flushes them. */
+  GPtrArray *ready_videos;
+  GPtrArray *ready_shows;
+  GArray *ready_times;
+  guint flush_id;
+  guint flush_idle_id;
+} TotemSeriesSummaryPrivate;
+
+/* A show of the library. The metadata and poster shared by all its
+ * episodes are resolved only once and kept here; its view is created
+ * with the first episode ready. */
+typedef struct _ShowData
+{
+  TotemSeriesSummary *summary;
+  gchar              *key;
+  gchar              *name;
+  guint               id;
+
+  GrlMedia  *media;
+  gboolean   resolving;
+  GQueue     waiters;
+
+  /* Unknown to the metadata source, its episodes are not looked up */
+  gboolean   failed;
+
+  /* Series data is revalidated with the first stale episode only */
+  gboolean   revalidated;
+
+  gchar        *poster_url;
+  GdkPixbuf    *poster;
+  /* Of the poster being loaded, if any */
+  GCancellable *poster_cancellable;
 
   TotemSeriesView *view;
+  gint             visible_season;
+} ShowData;
 
-  GList *pending_ops;
-} TotemSeriesSummaryPrivate;
+typedef struct _OperationSpec OperationSpec;
 
-typedef struct _VideoSummaryData VideoSummaryData;
+typedef void (*OperationFunc) (OperationSpec *os);
 
-typedef struct
+struct _OperationSpec
 {
+  /* NULL once the operation is cancelled */
   TotemSeriesSummary *totem_series_summary;
   GrlMedia           *video;
+  gchar              *url;
+  GCancellable       *cancellable;
 
   gchar    *poster_path;
   gboolean  is_tv_show;
+  gboolean  from_cache;
 
-  VideoSummaryData *video_summary;
-  GList            *pending_grl_ops;
-} OperationSpec;
+  /* @video holds stale cached data and is resolved again. Its cached
+   * series data is set aside meanwhile, see take_series_data(). */
+  gboolean  stale;
+  GrlMedia *stale_series;
 
-struct _VideoSummaryData
-{
-  gchar    *title;
-  gchar    *description;
-  gchar    *genre;
-  gchar    *performer;
-  gchar    *director;
-  gchar    *author;
-  gchar    *poster_path;
-  gchar    *publication_date;
-  gboolean  is_tv_show;
+  /* Resolving failed, @video is shown with what it has but not cached */
+  gboolean  offline;
 
-  GHashTable *subtitles;
+  /* Resolving @video again to update @shown in the background */
+  gboolean  revalidate;
+  gboolean  revalidate_series;
+  GrlMedia *shown;
+
+  /* Looking up the subtitles of @url */
+  gboolean  lookup_subtitles;
+
+  ShowData *show;
+  GList    *show_link;
+  gboolean  show_leader;
+
+  /* Start of the current stage, in monotonic time */
+  gint64 stage_start;
+
+  /* An async call will call back, it releases the operation if cancelled */
+  gboolean   busy;
+  guint      grl_op_id;
+  GrlSource *grl_source;
+
+  /* Failed requests are retried later, see schedule_retry() */
+  guint         attempts;
+  guint         retry_id;
+  OperationFunc retry_func;
 };
 
 #define POSTER_WIDTH  266
 #define POSTER_HEIGHT 333
 
+/* Files requested at once while walking a directory */
+#define SCAN_BATCH_SIZE 100
+#define SCAN_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+                        G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+                        G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+                        G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE "," \
+                        G_FILE_ATTRIBUTE_STANDARD_SIZE
+
+/* Quiet time after the last file event before the library is updated */
+#define WATCH_DEBOUNCE_MS 1000
+
+/* For files without a known content type */
+static const gchar *video_extensions[] = {
+  ".mkv", ".avi", ".mp4", ".m4v", ".mov", ".ogv", ".webm", ".wmv",
+  ".mpg", ".mpeg", ".ts", ".flv", NULL
+};
+
+/* Requests failing are retried after a random delay of up to RETRY_BASE_MS,
+ * doubled on each new failure and capped to RETRY_MAX_MS */
+#define RETRY_BASE_MS      1000
+#define RETRY_MAX_MS       60000
+#define RETRY_MAX_ATTEMPTS 4
+
+/* Seasons around the visible one resolved before the rest of the library */
+#define PREFETCH_SEASONS 1
+
+/* Title of the videos without a show */
+#define NO_SHOW_NAME "Other videos"
+
+static const gchar *stage_names[TOTEM_SERIES_SUMMARY_N_STAGES] = {
+  "hash", "parse", "resolve", "poster", "view"
+};
+
+enum {
+  STAGE_FINISHED,
+  SUBTITLE_READY,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
 /* FIXME: Almost random. Probably we don't want to use wrap-width :) */
 #define WRAP_WIDTH_SUBTITLES(n) ((n > 25) ? 8 : 4)
 
-static gchar *get_data_from_media (GrlData *data, GrlKeyID key);
+static void copy_keys (GrlData *from, GrlData *to, GList *keys);
+static void push_subtitles_lookup (OperationSpec *os);
+static void resolve_by_the_tvdb (OperationSpec *os);
+static void resolve_poster (OperationSpec *os);
+static void push_tvdb_resolve (OperationSpec *os);
+static void resolve_by_video_title_parsing (OperationSpec *os);
 
 G_DEFINE_TYPE_WITH_PRIVATE (TotemSeriesSummary, totem_series_summary, GTK_TYPE_BIN);
 
@@ -87,24 +246,469 @@ G_DEFINE_TYPE_WITH_PRIVATE (TotemSeriesSummary, totem_series_summary, GTK_TYPE_B
  * Internal / Helpers
  * -------------------------------------------------------------------------- */
 
+static GHashTable *
+get_operation_table (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+
+  if (os->lookup_subtitles)
+    return priv->subtitle_lookups;
+
+  return os->revalidate ? priv->revalidations : priv->operations;
+}
+
+/* Remove @os from the summary's bookkeeping. A show leader hands the
+ * series wide request over to the next episode waiting for it. */
 static void
-operation_spec_free (OperationSpec *os)
+operation_spec_detach (OperationSpec *os)
 {
-  TotemSeriesSummaryPrivate *priv;
+  ShowData *show = os->show;
+
+  if (os->totem_series_summary == NULL)
+    return;
+
+  g_hash_table_remove (get_operation_table (os), os->url);
+  os->totem_series_summary = NULL;
 
-  if (os->pending_grl_ops != NULL) {
-    /* Wait pending grilo operations to finish */
+  if (show == NULL)
     return;
+
+  if (os->show_link != NULL) {
+    g_queue_delete_link (&show->waiters, os->show_link);
+    os->show_link = NULL;
   }
 
-  priv = os->totem_series_summary->priv;
-  priv->pending_ops = g_list_remove (priv->pending_ops, os);
+  if (os->show_leader) {
+    OperationSpec *next;
+
+    os->show_leader = FALSE;
+    next = g_queue_pop_head (&show->waiters);
+    if (next != NULL) {
+      next->show_link = NULL;
+      next->show_leader = TRUE;
+      push_tvdb_resolve (next);
+    } else {
+      show->resolving = FALSE;
+    }
+  }
+}
+
+static void
+operation_spec_free (OperationSpec *os)
+{
+  operation_spec_detach (os);
 
   g_clear_object (&os->video);
+  g_clear_object (&os->shown);
+  g_clear_object (&os->stale_series);
+  g_clear_object (&os->cancellable);
+  g_clear_pointer (&os->url, g_free);
   g_clear_pointer (&os->poster_path, g_free);
   g_slice_free (OperationSpec, os);
 }
 
+/* Stop all work of @os. Whatever is running is cancelled and releases @os
+ * on its callback, otherwise it is released right away. */
+static void
+operation_spec_cancel (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+  GrlSource *grl_source = os->grl_source;
+  guint grl_op_id = os->grl_op_id;
+  gboolean busy = os->busy;
+
+  operation_spec_detach (os);
+  if (os->retry_id != 0) {
+    g_source_remove (os->retry_id);
+    os->retry_id = 0;
+  }
+  if (!busy)
+    totem_scheduler_cancel (priv->scheduler, os);
+
+  /* Callbacks might run and release @os from here on. The slot is given
+   * back last, it might start the next queued operation right away. */
+  g_cancellable_cancel (os->cancellable);
+  if (grl_op_id != 0) {
+    grl_operation_cancel (grl_op_id);
+    totem_scheduler_done (priv->scheduler, grl_source);
+  }
+
+  if (!busy)
+    operation_spec_free (os);
+}
+
+/* First thing in every async callback of @os. Returns FALSE if @os was
+ * cancelled meanwhile, and releases it. */
+static gboolean
+operation_spec_returned (OperationSpec *os)
+{
+  os->busy = FALSE;
+  os->grl_op_id = 0;
+
+  if (!g_cancellable_is_cancelled (os->cancellable))
+    return TRUE;
+
+  operation_spec_free (os);
+  return FALSE;
+}
+
+static gboolean
+retry_timeout (gpointer user_data)
+{
+  OperationSpec *os = user_data;
+
+  os->retry_id = 0;
+  os->retry_func (os);
+  return G_SOURCE_REMOVE;
+}
+
+/* Run @func again later, after an exponential backoff with jitter so that
+ * requests failing together do not come back together. Returns FALSE once
+ * @os failed too many times. */
+static gboolean
+schedule_retry (OperationSpec *os,
+                OperationFunc  func)
+{
+  guint max_delay;
+
+  if (os->attempts >= RETRY_MAX_ATTEMPTS)
+    return FALSE;
+
+  max_delay = MIN (RETRY_BASE_MS << os->attempts, RETRY_MAX_MS);
+  os->attempts++;
+  os->retry_func = func;
+  os->retry_id = g_timeout_add (g_random_int_range (max_delay / 2, max_delay + 1),
+                                retry_timeout, os);
+  return TRUE;
+}
+
+/* Another episode of the show will load its poster again */
+static void
+cancel_show_poster (ShowData *show)
+{
+  if (show->poster_cancellable == NULL)
+    return;
+
+  g_cancellable_cancel (show->poster_cancellable);
+  g_clear_object (&show->poster_cancellable);
+  g_clear_pointer (&show->poster_url, g_free);
+}
+
+static void
+cancel_all_operations (TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  GHashTableIter iter;
+  ShowData *show;
+  GList *ops, *it;
+
+  /* Waiting episodes go away as well, no need to promote them */
+  g_hash_table_iter_init (&iter, priv->shows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &show)) {
+    OperationSpec *os;
+
+    cancel_show_poster (show);
+
+    while ((os = g_queue_pop_head (&show->waiters)) != NULL) {
+      os->show_link = NULL;
+      os->show = NULL;
+    }
+  }
+
+  ops = g_list_concat (g_hash_table_get_values (priv->operations),
+                       g_hash_table_get_values (priv->revalidations));
+  ops = g_list_concat (ops, g_hash_table_get_values (priv->subtitle_lookups));
+
+  /* Queued operations go first, otherwise the slots given back by the
+   * running ones would start them */
+  for (it = ops; it != NULL; it = it->next) {
+    OperationSpec *os = it->data;
+
+    if (!os->busy) {
+      operation_spec_cancel (os);
+      it->data = NULL;
+    }
+  }
+  for (it = ops; it != NULL; it = it->next) {
+    OperationSpec *os = it->data;
+
+    if (os != NULL && os->busy)
+      operation_spec_cancel (os);
+  }
+  g_list_free (ops);
+
+  g_cancellable_cancel (priv->subtitle_cancellable);
+  g_object_unref (priv->subtitle_cancellable);
+  priv->subtitle_cancellable = g_cancellable_new ();
+}
+
+static void
+record_stage (TotemSeriesSummary      *self,
+              GrlMedia                *video,
+              TotemSeriesSummaryStage  stage,
+              gint64                   start,
+              gint64                   end)
+{
+  TotemSeriesSummaryStageStats *stats = &self->priv->stage_stats[stage];
+
+  stats->count++;
+  stats->total += end - start;
+  stats->max = MAX (stats->max, end - start);
+
+  totem_trace_span (stage_names[stage], start, end, grl_media_get_url (video));
+  if (g_signal_has_handler_pending (self, signals[STAGE_FINISHED], 0, FALSE))
+    g_signal_emit (self, signals[STAGE_FINISHED], 0, video, stage, end - start);
+}
+
+/* Stages follow each other, the next one starts right away */
+static void
+stage_finished (OperationSpec           *os,
+                TotemSeriesSummaryStage  stage)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  record_stage (os->totem_series_summary, os->video, stage, os->stage_start, now);
+  os->stage_start = now;
+}
+
+/* Queue depth of @source, for the trace */
+static void
+trace_queue (TotemSeriesSummary *self,
+             GrlSource          *source)
+{
+  gchar *name;
+
+  if (!totem_trace_is_enabled ())
+    return;
+
+  name = g_strdup_printf ("queue %s", grl_source_get_id (source));
+  totem_trace_counter (name, totem_scheduler_get_queued (self->priv->scheduler, source));
+  g_free (name);
+}
+
+static void
+show_data_free (ShowData *show)
+{
+  g_clear_object (&show->media);
+  g_queue_clear (&show->waiters);
+  g_clear_object (&show->poster);
+  g_clear_object (&show->poster_cancellable);
+  g_free (show->poster_url);
+  g_free (show->name);
+  g_free (show->key);
+  g_slice_free (ShowData, show);
+}
+
+/* "The Office (US)" and "the.office.us" are the same show */
+static gchar *
+normalize_show_name (const gchar *name)
+{
+  gchar *normalized, *folded;
+  const gchar *p;
+  GString *key;
+
+  normalized = g_utf8_normalize (name, -1, G_NORMALIZE_ALL);
+  if (normalized == NULL)
+    return g_ascii_strdown (name, -1);
+
+  folded = g_utf8_casefold (normalized, -1);
+  key = g_string_sized_new (strlen (folded));
+  for (p = folded; *p != '\0'; p = g_utf8_next_char (p)) {
+    gunichar c = g_utf8_get_char (p);
+
+    if (g_unichar_isalnum (c))
+      g_string_append_unichar (key, c);
+  }
+
+  g_free (normalized);
+  g_free (folded);
+  return g_string_free (key, FALSE);
+}
+
+static ShowData *
+lookup_show (TotemSeriesSummary *self,
+             const gchar        *name)
+{
+  ShowData *show;
+  gchar *key;
+
+  if (name == NULL)
+    name = NO_SHOW_NAME;
+
+  key = normalize_show_name (name);
+  show = g_hash_table_lookup (self->priv->shows, key);
+  if (show != NULL) {
+    g_free (key);
+    return show;
+  }
+
+  show = g_slice_new0 (ShowData);
+  show->summary = self;
+  show->key = key;
+  show->name = g_strdup (name);
+  show->id = g_hash_table_size (self->priv->shows);
+  show->visible_season = -1;
+  show->failed = totem_metadata_cache_show_has_failed (self->priv->metadata_cache, key);
+  g_hash_table_insert (self->priv->shows, show->key, show);
+
+  return show;
+}
+
+/* Scheduler group of the episodes of @season of @show */
+#define GROUP_SHOW(group)  (((guint) (group) >> 16) & 0x7fff)
+#define GROUP_SEASON(group) ((group) & 0xffff)
+
+static gint
+get_season_group (ShowData *show,
+                  gint      season)
+{
+  return (gint) (((show->id & 0x7fff) << 16) | (season & 0xffff));
+}
+
+/* Once a show is visible: its visible season first, then the seasons next
+ * to it, then everything else */
+static TotemSchedulerPriority
+get_group_priority (TotemSeriesSummary *self,
+                    gint                group)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  gint distance;
+
+  if (priv->visible_show == NULL)
+    return TOTEM_SCHEDULER_PRIORITY_DEFAULT;
+
+  if (GROUP_SHOW (group) != (priv->visible_show->id & 0x7fff))
+    return TOTEM_SCHEDULER_PRIORITY_PREFETCH;
+
+  if (priv->visible_season < 0)
+    return TOTEM_SCHEDULER_PRIORITY_DEFAULT;
+
+  distance = ABS (GROUP_SEASON (group) - priv->visible_season);
+  if (distance == 0)
+    return TOTEM_SCHEDULER_PRIORITY_VISIBLE;
+  if (distance <= PREFETCH_SEASONS)
+    return TOTEM_SCHEDULER_PRIORITY_DEFAULT;
+  return TOTEM_SCHEDULER_PRIORITY_PREFETCH;
+}
+
+static gboolean
+has_series_data (TotemSeriesSummary *self,
+                 GrlMedia           *video)
+{
+  GList *it;
+
+  for (it = self->priv->series_keys; it != NULL; it = it->next) {
+    if (grl_data_length (GRL_DATA (video), GRLPOINTER_TO_KEYID (it->data)) > 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static void
+show_data_set_media (ShowData *show,
+                     GrlMedia *media)
+{
+  g_clear_object (&show->media);
+  show->media = grl_media_video_new ();
+  copy_keys (GRL_DATA (media), GRL_DATA (show->media), show->summary->priv->series_keys);
+  if (show->view != NULL)
+    totem_series_view_set_show (show->view, show->media);
+}
+
+/* Only string keys are shared among episodes */
+static void
+copy_keys (GrlData *from,
+           GrlData *to,
+           GList   *keys)
+{
+  GList *it;
+
+  for (it = keys; it != NULL; it = it->next) {
+    GrlKeyID key = GRLPOINTER_TO_KEYID (it->data);
+    guint i, len;
+
+    len = grl_data_length (from, key);
+    if (len == 0)
+      continue;
+
+    while (grl_data_length (to, key) > 0)
+      grl_data_remove (to, key);
+
+    for (i = 0; i < len; i++) {
+      GrlRelatedKeys *relkeys;
+      const gchar *value;
+
+      relkeys = grl_data_get_related_keys (from, key, i);
+      value = grl_related_keys_get_string (relkeys, key);
+      if (value != NULL)
+        grl_data_add_string (to, key, value);
+    }
+  }
+}
+
+/* Series data cached in @os->video is set aside while it is resolved, so
+ * that what the source returns is told apart from what was there */
+static void
+take_series_data (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+  GList *it;
+
+  if (os->stale_series != NULL || !has_series_data (os->totem_series_summary, os->video))
+    return;
+
+  os->stale_series = grl_media_video_new ();
+  copy_keys (GRL_DATA (os->video), GRL_DATA (os->stale_series), priv->series_keys);
+  for (it = priv->series_keys; it != NULL; it = it->next) {
+    GrlKeyID key = GRLPOINTER_TO_KEYID (it->data);
+
+    while (grl_data_length (GRL_DATA (os->video), key) > 0)
+      grl_data_remove (GRL_DATA (os->video), key);
+  }
+}
+
+/* The cached series data comes back unless the source returned some */
+static void
+restore_series_data (OperationSpec *os)
+{
+  if (os->stale_series == NULL)
+    return;
+
+  if (!has_series_data (os->totem_series_summary, os->video))
+    copy_keys (GRL_DATA (os->stale_series), GRL_DATA (os->video),
+               os->totem_series_summary->priv->series_keys);
+  g_clear_object (&os->stale_series);
+}
+
+/* The first episode of a show resolved the series wide keys, or failed
+ * to. Either way, the episodes waiting for it can go on now. If the source
+ * kept failing on @error, they are all shown offline at once instead of
+ * each one retrying in turn. */
+static void
+show_data_resolved (TotemSeriesSummary *self,
+                    ShowData           *show,
+                    GrlMedia           *media,
+                    const GError       *error)
+{
+  OperationSpec *os;
+
+  show->resolving = FALSE;
+  if (media != NULL && grl_media_get_show (media) != NULL)
+    show_data_set_media (show, media);
+
+  while ((os = g_queue_pop_head (&show->waiters)) != NULL) {
+    os->show_link = NULL;
+    if (error == NULL) {
+      resolve_by_the_tvdb (os);
+      continue;
+    }
+
+    os->offline = TRUE;
+    stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_RESOLVE);
+    resolve_poster (os);
+  }
+}
+
 static void
 totem_series_summary_set_basic_content (TotemSeriesSummary *self,
                                         GrlMedia           *video)
@@ -121,99 +725,594 @@ totem_series_summary_set_basic_content (TotemSeriesSummary *self,
 /*    gtk_label_set_text (self->priv->title, title);*/
 }
 
+static gint
+compare_languages (gconstpointer a,
+                   gconstpointer b,
+                   gpointer      user_data)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* @subtitles maps the languages found for @url to their subtitle url */
 static void
-video_summary_set_subtitles (TotemSeriesSummary *self,
-                             VideoSummaryData   *video_summary,
-                             GrlData            *data)
+show_subtitles (ShowData    *show,
+                const gchar *url,
+                GHashTable  *subtitles)
 {
-  guint i, length;
+  const gchar **languages;
+  guint n_languages;
+
+  if (show->view == NULL)
+    return;
+
+  languages = (const gchar **) g_hash_table_get_keys_as_array (subtitles, &n_languages);
+  g_qsort_with_data (languages, n_languages, sizeof (gchar *), compare_languages, NULL);
+  totem_series_view_set_subtitles (show->view, url, languages);
+  g_free (languages);
+}
+
+static void
+subtitles_lookup_done (GrlSource    *source,
+                       guint         operation_id,
+                       GrlMedia     *media,
+                       gpointer      user_data,
+                       const GError *error)
+{
+  OperationSpec *os = user_data;
   TotemSeriesSummaryPrivate *priv;
+  GHashTable *subtitles;
+  guint i, length;
 
-  if (video_summary == NULL || video_summary->subtitles != NULL)
+  if (!operation_spec_returned (os))
     return;
 
-  priv = self->priv;
-  length = grl_data_length (data, priv->subtitles_lang_key);
+  priv = os->totem_series_summary->priv;
+  totem_scheduler_done (priv->scheduler, source);
+  trace_queue (os->totem_series_summary, source);
 
-  if (length == 0)
+  if (error != NULL && schedule_retry (os, push_subtitles_lookup)) {
+    g_debug ("Subtitles lookup failed, retrying: %s", error->message);
     return;
+  }
 
-  video_summary->subtitles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  subtitles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  length = (error == NULL) ? grl_data_length (GRL_DATA (media), priv->subtitles_lang_key) : 0;
   for (i = 0; i < length; i++) {
     GrlRelatedKeys *relkeys;
     const gchar *sub_url, *sub_lang;
 
-    relkeys = grl_data_get_related_keys (data, priv->subtitles_lang_key, i);
+    relkeys = grl_data_get_related_keys (GRL_DATA (media), priv->subtitles_lang_key, i);
     sub_lang = grl_related_keys_get_string (relkeys, priv->subtitles_lang_key);
     sub_url = grl_related_keys_get_string (relkeys, priv->subtitles_url_key);
-    if (sub_lang == NULL || sub_url == NULL)
+    if (sub_lang == NULL || sub_url == NULL || g_hash_table_contains (subtitles, sub_lang))
       continue;
 
-    g_hash_table_insert (video_summary->subtitles,
+    g_hash_table_insert (subtitles,
                          g_strdup (sub_lang),
                          g_strdup (sub_url));
   }
-}
-
-static void
-add_video_to_summary_and_free (OperationSpec *os)
-{
-  TotemSeriesSummary *self = os->totem_series_summary;
-  VideoSummaryData *data;
-  GDateTime *released;
-
-  data = g_slice_new0 (VideoSummaryData);
-  data->is_tv_show = (grl_media_get_show (os->video) != NULL);
-  data->description = g_strdup (grl_media_get_description (os->video));
-  data->genre = get_data_from_media (GRL_DATA (os->video), GRL_METADATA_KEY_GENRE);
-  data->performer = get_data_from_media (GRL_DATA (os->video),
-                                         GRL_METADATA_KEY_PERFORMER);
-  data->director = get_data_from_media (GRL_DATA (os->video),
-                                        GRL_METADATA_KEY_DIRECTOR);
-  data->author = get_data_from_media (GRL_DATA (os->video),
-                                      GRL_METADATA_KEY_AUTHOR);
-  data->poster_path = g_strdup (os->poster_path);
-
-  released = grl_media_get_publication_date (os->video);
-  if (released)
-    data->publication_date = g_date_time_format (released, "%F");
-
-  if (data->is_tv_show)
-    data->title = g_strdup (grl_media_get_episode_title (os->video));
-  else
-    data->title = g_strdup (grl_media_get_title (os->video));
 
-  video_summary_set_subtitles (self, os->video_summary, GRL_DATA (os->video));
+  show_subtitles (os->show, os->url, subtitles);
 
-  /* Cache VideoSummaryData as we might have other async calls */
-  os->video_summary = data;
+  /* Asked again the next time the row is created */
+  if (error != NULL) {
+    g_debug ("Subtitles lookup of %s failed: %s", os->url, error->message);
+    g_hash_table_unref (subtitles);
+  } else {
+    g_hash_table_insert (priv->subtitles, g_strdup (os->url), subtitles);
+  }
 
-  totem_series_view_add_video (self->priv->view, os->video);
   operation_spec_free (os);
 }
 
 static void
-resolve_poster_done (GObject      *source_object,
-                     GAsyncResult *res,
-                     gpointer      user_data)
+start_subtitles_lookup (gpointer user_data)
 {
-  OperationSpec *os;
-  gchar *data;
-  gsize len;
-  GError *err = NULL;
+  OperationSpec *os = user_data;
+  TotemSeriesSummaryPrivate *priv;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlCaps *caps;
+  guint op_id;
 
-  os = user_data;
-  grl_net_wc_request_finish (GRL_NET_WC (source_object),
-                             res, &data, &len, &err);
-  if (err != NULL) {
-    g_warning ("Fetch image failed due: %s", err->message);
-    g_error_free (err);
-  } else {
-    g_file_set_contents (os->poster_path, data, len, &err);
-  }
+  priv = os->totem_series_summary->priv;
+  keys = grl_metadata_key_list_new (priv->subtitles_lang_key, priv->subtitles_url_key, NULL);
 
-  /* Update interface */
-  add_video_to_summary_and_free (os);
+  caps = grl_source_get_caps (priv->opensubtitles_source, GRL_OP_RESOLVE);
+  options = grl_operation_options_new (caps);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
+
+  os->busy = TRUE;
+  os->grl_source = priv->opensubtitles_source;
+  op_id = grl_source_resolve (priv->opensubtitles_source,
+                              os->video,
+                              keys,
+                              options,
+                              subtitles_lookup_done,
+                              os);
+  g_object_unref (options);
+  g_list_free (keys);
+
+  os->grl_op_id = op_id;
+}
+
+/* The user is waiting on it */
+static void
+push_subtitles_lookup (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+
+  totem_scheduler_push (self->priv->scheduler,
+                        self->priv->opensubtitles_source,
+                        TOTEM_SCHEDULER_PRIORITY_VISIBLE,
+                        TOTEM_SCHEDULER_NO_GROUP,
+                        start_subtitles_lookup,
+                        os);
+  trace_queue (self, self->priv->opensubtitles_source);
+}
+
+/* A row was expanded or hovered; subtitles are never looked up before */
+static void
+subtitles_needed_cb (TotemSeriesView    *view,
+                     const TotemEpisode *episode,
+                     ShowData           *show)
+{
+  TotemSeriesSummary *self = show->summary;
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  GHashTable *subtitles;
+  OperationSpec *os;
+
+  subtitles = g_hash_table_lookup (priv->subtitles, episode->url);
+  if (subtitles != NULL) {
+    show_subtitles (show, episode->url, subtitles);
+    return;
+  }
+
+  /* Subtitles are found by the hash and size of the file */
+  if (priv->opensubtitles_source == NULL || episode->hash == NULL ||
+      g_hash_table_contains (priv->subtitle_lookups, episode->url))
+    return;
+
+  os = g_slice_new0 (OperationSpec);
+  os->totem_series_summary = self;
+  os->url = g_strdup (episode->url);
+  os->cancellable = g_cancellable_new ();
+  os->show = show;
+  os->lookup_subtitles = TRUE;
+
+  os->video = grl_media_video_new ();
+  grl_media_set_url (os->video, episode->url);
+  grl_media_set_size (os->video, episode->size);
+  grl_data_set_string (GRL_DATA (os->video), priv->gibest_hash_key, episode->hash);
+
+  g_hash_table_insert (priv->subtitle_lookups, os->url, os);
+  push_subtitles_lookup (os);
+}
+
+/* Subtitles picked by the user, being fetched into the subtitle cache */
+typedef struct
+{
+  TotemSeriesSummary *summary;
+  gchar              *url;
+  gchar              *language;
+} SubtitleFetch;
+
+static void
+subtitle_fetched (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  SubtitleFetch *fetch = user_data;
+  GError *err = NULL;
+  gchar *path;
+
+  path = totem_subtitle_cache_fetch_finish (TOTEM_SUBTITLE_CACHE (source_object), res, &err);
+  if (path != NULL) {
+    g_signal_emit (fetch->summary, signals[SUBTITLE_READY], 0,
+                   fetch->url, fetch->language, path);
+    g_free (path);
+  } else {
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_warning ("Failed to fetch subtitles of %s: %s", fetch->url, err->message);
+    g_error_free (err);
+  }
+
+  g_object_unref (fetch->summary);
+  g_free (fetch->url);
+  g_free (fetch->language);
+  g_slice_free (SubtitleFetch, fetch);
+}
+
+/* Picking a language again, or for the same file elsewhere, never
+ * downloads the subtitles again */
+static void
+subtitle_selected_cb (TotemSeriesView    *view,
+                      const TotemEpisode *episode,
+                      const gchar        *language,
+                      ShowData           *show)
+{
+  TotemSeriesSummaryPrivate *priv = show->summary->priv;
+  SubtitleFetch *fetch;
+  GHashTable *subtitles;
+  const gchar *sub_url;
+
+  subtitles = g_hash_table_lookup (priv->subtitles, episode->url);
+  sub_url = subtitles ? g_hash_table_lookup (subtitles, language) : NULL;
+  if (sub_url == NULL || episode->hash == NULL)
+    return;
+
+  /* Summaries are only released once the subtitles are in, or the
+   * download is cancelled */
+  fetch = g_slice_new0 (SubtitleFetch);
+  fetch->summary = g_object_ref (show->summary);
+  fetch->url = g_strdup (episode->url);
+  fetch->language = g_strdup (language);
+  totem_subtitle_cache_fetch_async (priv->subtitle_cache, episode->hash, language, sub_url,
+                                    priv->subtitle_cancellable, subtitle_fetched, fetch);
+}
+
+static void season_changed_cb (TotemSeriesView *view, gint season, ShowData *show);
+
+static void
+create_show_view (TotemSeriesSummary *self,
+                  ShowData           *show)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  show->view = totem_series_view_new ();
+  if (show->media != NULL)
+    totem_series_view_set_show (show->view, show->media);
+  if (show->poster != NULL)
+    totem_series_view_set_poster (show->view, show->poster);
+  g_signal_connect (show->view, "season-changed",
+                    G_CALLBACK (season_changed_cb), show);
+  g_signal_connect (show->view, "subtitles-needed",
+                    G_CALLBACK (subtitles_needed_cb), show);
+  g_signal_connect (show->view, "subtitle-selected",
+                    G_CALLBACK (subtitle_selected_cb), show);
+
+  gtk_widget_show (GTK_WIDGET (show->view));
+  gtk_stack_add_titled (priv->views, GTK_WIDGET (show->view), show->key, show->name);
+
+  /* No need to choose with a single show */
+  priv->n_views++;
+  gtk_widget_set_visible (priv->sidebar, priv->n_views > 1);
+}
+
+static void
+flush_ready_videos (TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  gint64 now;
+  guint i;
+
+  for (i = 0; i < priv->ready_videos->len; i++) {
+    ShowData *show = g_ptr_array_index (priv->ready_shows, i);
+
+    if (show->view == NULL)
+      create_show_view (self, show);
+    totem_series_view_add_video (show->view, g_ptr_array_index (priv->ready_videos, i));
+  }
+
+  now = g_get_monotonic_time ();
+  for (i = 0; i < priv->ready_videos->len; i++)
+    record_stage (self, g_ptr_array_index (priv->ready_videos, i),
+                  TOTEM_SERIES_SUMMARY_STAGE_VIEW,
+                  g_array_index (priv->ready_times, gint64, i), now);
+
+  g_ptr_array_set_size (priv->ready_videos, 0);
+  g_ptr_array_set_size (priv->ready_shows, 0);
+  g_array_set_size (priv->ready_times, 0);
+}
+
+static gboolean
+flush_ready_videos_tick (GtkWidget     *widget,
+                         GdkFrameClock *frame_clock,
+                         gpointer       user_data)
+{
+  TotemSeriesSummary *self = TOTEM_SERIES_SUMMARY (widget);
+
+  self->priv->flush_id = 0;
+  flush_ready_videos (self);
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+flush_ready_videos_idle (gpointer user_data)
+{
+  TotemSeriesSummary *self = user_data;
+
+  self->priv->flush_idle_id = 0;
+  flush_ready_videos (self);
+  return G_SOURCE_REMOVE;
+}
+
+static void
+cancel_flush (TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  if (priv->flush_id != 0) {
+    gtk_widget_remove_tick_callback (GTK_WIDGET (self), priv->flush_id);
+    priv->flush_id = 0;
+  }
+  if (priv->flush_idle_id != 0) {
+    g_source_remove (priv->flush_idle_id);
+    priv->flush_idle_id = 0;
+  }
+}
+
+static void
+queue_flush (TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  if (priv->flush_id != 0 || priv->flush_idle_id != 0)
+    return;
+
+  if (gtk_widget_get_mapped (GTK_WIDGET (self)))
+    priv->flush_id = gtk_widget_add_tick_callback (GTK_WIDGET (self), flush_ready_videos_tick,
+                                                   NULL, NULL);
+  else
+    priv->flush_idle_id = g_idle_add (flush_ready_videos_idle, self);
+}
+
+static void
+queue_ready_video (TotemSeriesSummary *self,
+                   ShowData           *show,
+                   GrlMedia           *video)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  gint64 now = g_get_monotonic_time ();
+
+  g_ptr_array_add (priv->ready_videos, g_object_ref (video));
+  g_ptr_array_add (priv->ready_shows, show);
+  g_array_append_val (priv->ready_times, now);
+  queue_flush (self);
+}
+
+static const gchar *
+get_poster_url (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+
+  if (os->is_tv_show)
+    return grl_data_get_string (GRL_DATA (os->video), priv->tvdb_poster_key);
+
+  return grl_data_get_string (GRL_DATA (os->video), priv->tmdb_poster_key);
+}
+
+/* The load of a show's poster; it is outdated once the show starts
+ * another one or cancels it */
+typedef struct
+{
+  ShowData     *show;
+  GCancellable *cancellable;
+} PosterLoad;
+
+static void
+poster_scaled_done (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  PosterLoad *load = user_data;
+  ShowData *show = load->show;
+  TotemSeriesSummary *self = show->summary;
+  GdkPixbuf *poster;
+  GError *err = NULL;
+
+  poster = totem_poster_cache_load_scaled_finish (TOTEM_POSTER_CACHE (source_object), res, &err);
+  if (load->cancellable != show->poster_cancellable) {
+    /* Cancelled or replaced meanwhile */
+    g_clear_object (&poster);
+    g_clear_error (&err);
+  } else if (poster != NULL) {
+    g_clear_object (&show->poster_cancellable);
+    g_clear_object (&show->poster);
+    show->poster = poster;
+    if (show->view != NULL)
+      totem_series_view_set_poster (show->view, poster);
+  } else {
+    g_warning ("Failed to load poster: %s", err->message);
+    g_error_free (err);
+    g_clear_object (&show->poster_cancellable);
+    g_clear_pointer (&show->poster_url, g_free);
+  }
+
+  g_object_unref (load->cancellable);
+  g_slice_free (PosterLoad, load);
+  g_object_unref (self);
+}
+
+/* The view gets the poster of the show decoded and scaled already */
+static void
+show_poster (OperationSpec *os,
+             ShowData      *show)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+  const gchar *poster_url;
+  PosterLoad *load;
+
+  poster_url = get_poster_url (os);
+  if (os->poster_path == NULL || poster_url == NULL || show->poster_url != NULL)
+    return;
+
+  /* Shows are only released with the summary, which is kept until the
+   * load returns; cancel_all_operations() stops it */
+  show->poster_url = g_strdup (poster_url);
+  show->poster_cancellable = g_cancellable_new ();
+  load = g_slice_new0 (PosterLoad);
+  load->show = show;
+  load->cancellable = g_object_ref (show->poster_cancellable);
+  g_object_ref (self);
+  totem_poster_cache_load_scaled_async (self->priv->poster_cache, poster_url,
+                                        POSTER_WIDTH, POSTER_HEIGHT, show->poster_cancellable,
+                                        poster_scaled_done, load);
+}
+
+static void
+add_video_to_summary_and_free (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+  ShowData *show;
+
+  show = os->show ? os->show : lookup_show (self, grl_media_get_show (os->video));
+
+  /* Only the first episode of a show resolves its series data; every
+   * episode is cached with it so that none depends on the entry of
+   * another one on the next run */
+  if (show->media != NULL && !has_series_data (self, os->video))
+    copy_keys (GRL_DATA (show->media), GRL_DATA (os->video), self->priv->series_keys);
+
+  if (!os->from_cache && !os->offline)
+    totem_metadata_cache_store (self->priv->metadata_cache, os->video);
+
+  /* Episodes from the cache carry the series data of their show */
+  if (show->media == NULL && !show->resolving && has_series_data (self, os->video))
+    show_data_set_media (show, os->video);
+
+  stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_POSTER);
+  show_poster (os, show);
+  queue_ready_video (self, show, os->video);
+  operation_spec_free (os);
+}
+
+static void
+resolve_poster_done (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  OperationSpec *os;
+  GError *err = NULL;
+
+  os = user_data;
+  os->poster_path = totem_poster_cache_fetch_finish (TOTEM_POSTER_CACHE (source_object),
+                                                     res, &err);
+  if (!operation_spec_returned (os)) {
+    g_clear_error (&err);
+    return;
+  }
+
+  if (err != NULL) {
+    g_warning ("Fetch image failed due: %s", err->message);
+    g_error_free (err);
+  }
+
+  /* Update interface */
+  add_video_to_summary_and_free (os);
+}
+
+static void
+resolve_poster (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv;
+  const gchar *poster_url;
+
+  priv = os->totem_series_summary->priv;
+  poster_url = get_poster_url (os);
+
+  if (poster_url == NULL) {
+    add_video_to_summary_and_free (os);
+    return;
+  }
+
+  os->poster_path = totem_poster_cache_lookup (priv->poster_cache, poster_url);
+  if (os->poster_path != NULL) {
+    add_video_to_summary_and_free (os);
+    return;
+  }
+
+  /* Episodes of the same show share the download of the poster */
+  os->busy = TRUE;
+  totem_poster_cache_fetch_async (priv->poster_cache, poster_url, os->cancellable,
+                                  resolve_poster_done, os);
+}
+
+static void
+replace_show_poster (OperationSpec *os)
+{
+  cancel_show_poster (os->show);
+  g_clear_pointer (&os->show->poster_url, g_free);
+  show_poster (os, os->show);
+}
+
+static void
+revalidate_poster_done (GObject      *source_object,
+                        GAsyncResult *res,
+                        gpointer      user_data)
+{
+  OperationSpec *os = user_data;
+  GError *err = NULL;
+
+  os->poster_path = totem_poster_cache_fetch_finish (TOTEM_POSTER_CACHE (source_object),
+                                                     res, &err);
+  if (!operation_spec_returned (os)) {
+    g_clear_error (&err);
+    return;
+  }
+
+  if (err != NULL) {
+    g_debug ("Fetch of the new poster failed: %s", err->message);
+    g_error_free (err);
+  } else {
+    replace_show_poster (os);
+  }
+  operation_spec_free (os);
+}
+
+/* @media is the fresh metadata of the video shown from stale cached data;
+ * the row is only refreshed if something changed */
+static void
+revalidate_done (OperationSpec *os,
+                 GrlMedia      *media,
+                 const GError  *error)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+  ShowData *show = os->show;
+  const gchar *poster_url;
+
+  /* The stale data stays, e.g. while offline */
+  if (error != NULL) {
+    g_debug ("Revalidation of %s failed: %s", os->url, error->message);
+    operation_spec_free (os);
+    return;
+  }
+
+  /* Nor is it replaced by nothing, it is only revalidated again later */
+  if (grl_media_get_show (media) == NULL) {
+    g_debug ("Revalidation of %s did not tell anything", os->url);
+    totem_metadata_cache_postpone (priv->metadata_cache, os->shown);
+    operation_spec_free (os);
+    return;
+  }
+
+  if (os->revalidate_series && has_series_data (os->totem_series_summary, media))
+    show_data_set_media (show, media);
+  else
+    copy_keys (GRL_DATA (os->shown), GRL_DATA (media), priv->series_keys);
+
+  if (totem_metadata_cache_store (priv->metadata_cache, media)) {
+    totem_metadata_cache_lookup (priv->metadata_cache, os->shown);
+    if (show->view != NULL)
+      totem_series_view_update_video (show->view, os->shown);
+  }
+
+  poster_url = os->revalidate_series ? get_poster_url (os) : NULL;
+  if (poster_url == NULL || g_strcmp0 (poster_url, show->poster_url) == 0) {
+    operation_spec_free (os);
+    return;
+  }
+
+  os->poster_path = totem_poster_cache_lookup (priv->poster_cache, poster_url);
+  if (os->poster_path != NULL) {
+    replace_show_poster (os);
+    operation_spec_free (os);
+    return;
+  }
+
+  os->busy = TRUE;
+  totem_poster_cache_fetch_async (priv->poster_cache, poster_url, os->cancellable,
+                                  revalidate_poster_done, os);
 }
 
 static void
@@ -223,185 +1322,986 @@ resolve_metadata_done (GrlSource    *source,
                        gpointer      user_data,
                        const GError *error)
 {
-  TotemSeriesSummaryPrivate *priv;
   OperationSpec *os = user_data;
-  const gchar *title, *poster_url;
+  TotemSeriesSummaryPrivate *priv;
+  gboolean series_requested, series_returned;
+  const gchar *title;
+
+  if (!operation_spec_returned (os))
+    return;
+
+  priv = os->totem_series_summary->priv;
+  totem_scheduler_done (priv->scheduler, source);
+  trace_queue (os->totem_series_summary, source);
 
-  os->pending_grl_ops = g_list_remove (os->pending_grl_ops,
-                                       GUINT_TO_POINTER (operation_id));
+  /* Only what the source returned tells whether it knows the show */
+  series_returned = (error == NULL && has_series_data (os->totem_series_summary, media));
+  restore_series_data (os);
 
+  if (os->revalidate) {
+    revalidate_done (os, media, error);
+    return;
+  }
+
+  /* Most likely the network, the show stays with its leader meanwhile */
+  if (error != NULL && schedule_retry (os, push_tvdb_resolve)) {
+    g_debug ("Resolve operation failed, retrying: %s", error->message);
+    return;
+  }
+
+  stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_RESOLVE);
+
+  /* A show without any series data is unknown to the source; its next
+   * episodes are only shown with what their file name tells */
+  series_requested = (os->show_leader || !priv->bulk_fetch);
+  if (error == NULL && os->show != NULL && series_requested && !series_returned) {
+    g_debug ("Show not found: %s", os->show->name);
+    os->show->failed = TRUE;
+    totem_metadata_cache_store_show_failure (priv->metadata_cache, os->show->key);
+  }
+
+  /* Series wide data stays in the show, not in each episode */
+  if (os->show_leader) {
+    os->show_leader = FALSE;
+    show_data_resolved (os->totem_series_summary, os->show, error ? NULL : media, error);
+  }
+
+  /* Shown anyway with what the file name or a stale cache entry tells,
+   * but not cached so that it is resolved again on the next run */
   if (error) {
     g_warning ("Resolve operation failed: %s", error->message);
+    os->offline = TRUE;
+    resolve_poster (os);
+    return;
+  }
+
+  if (os->is_tv_show)
+    title = grl_media_get_show (media);
+  else
+    title = grl_media_get_title (media);
+
+  /* The stale entry is better than nothing, it is only tried again later */
+  if (title == NULL && os->stale) {
+    g_debug ("Resolving %s again did not tell anything", os->url);
+    totem_metadata_cache_postpone (priv->metadata_cache, os->video);
+    os->offline = TRUE;
+    resolve_poster (os);
+    return;
+  }
+
+  if (title == NULL) {
+    g_warning ("Basic information is missing - no title");
+    totem_metadata_cache_store_failure (priv->metadata_cache, os->video);
     operation_spec_free (os);
     return;
   }
 
-  priv = os->totem_series_summary->priv;
+  resolve_poster (os);
+}
+
+static void
+start_tvdb_resolve (gpointer user_data)
+{
+  OperationSpec *os = user_data;
+  TotemSeriesSummaryPrivate *priv;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlCaps *caps;
+  guint op_id;
+
+  priv = os->totem_series_summary->priv;
+
+  if (os->show != NULL && !os->show_leader && !os->revalidate_series) {
+    keys = g_list_copy (priv->episode_keys);
+  } else {
+    keys = g_list_concat (g_list_copy (priv->series_keys),
+                          g_list_copy (priv->episode_keys));
+    take_series_data (os);
+  }
+
+  caps = grl_source_get_caps (priv->tvdb_source, GRL_OP_RESOLVE);
+  options = grl_operation_options_new (caps);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
+
+  os->busy = TRUE;
+  os->grl_source = priv->tvdb_source;
+  op_id = grl_source_resolve (priv->tvdb_source,
+                              os->video,
+                              keys,
+                              options,
+                              resolve_metadata_done,
+                              os);
+  g_object_unref (options);
+  g_list_free (keys);
+
+  os->grl_op_id = op_id;
+}
+
+static void
+push_tvdb_resolve (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+  gint season;
+
+  season = grl_media_get_season (os->video);
+  totem_scheduler_push (self->priv->scheduler,
+                        self->priv->tvdb_source,
+                        get_group_priority (self, get_season_group (os->show, season)),
+                        get_season_group (os->show, season),
+                        start_tvdb_resolve,
+                        os);
+  trace_queue (self, self->priv->tvdb_source);
+}
+
+/* Revalidations wait for everything else */
+static void
+push_revalidation (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+
+  totem_scheduler_push (self->priv->scheduler,
+                        self->priv->tvdb_source,
+                        TOTEM_SCHEDULER_PRIORITY_PREFETCH,
+                        TOTEM_SCHEDULER_NO_GROUP,
+                        start_tvdb_resolve,
+                        os);
+  trace_queue (self, self->priv->tvdb_source);
+}
+
+/* @video is shown from stale cached data; resolve a copy of it in the
+ * background */
+static void
+revalidate_video (TotemSeriesSummary *self,
+                  GrlMedia           *video)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  const gchar *url = grl_media_get_url (video);
+  OperationSpec *os;
+  ShowData *show;
+
+  if (priv->tvdb_source == NULL || g_hash_table_contains (priv->revalidations, url))
+    return;
+
+  show = lookup_show (self, grl_media_get_show (video));
+  if (show->failed)
+    return;
+
+  os = g_slice_new0 (OperationSpec);
+  os->totem_series_summary = self;
+  os->url = g_strdup (url);
+  os->cancellable = g_cancellable_new ();
+  os->stage_start = g_get_monotonic_time ();
+  os->is_tv_show = TRUE;
+  os->show = show;
+  os->revalidate = TRUE;
+  os->shown = g_object_ref (video);
+
+  os->video = grl_media_video_new ();
+  grl_media_set_url (os->video, url);
+  grl_media_set_size (os->video, grl_media_get_size (video));
+  grl_data_set_string (GRL_DATA (os->video), priv->gibest_hash_key,
+                       grl_data_get_string (GRL_DATA (video), priv->gibest_hash_key));
+  grl_media_set_title (os->video, grl_media_get_title (video));
+  grl_media_set_show (os->video, grl_media_get_show (video));
+  grl_media_set_season (os->video, grl_media_get_season (video));
+  grl_media_set_episode (os->video, grl_media_get_episode (video));
+
+  if (!show->revalidated) {
+    show->revalidated = TRUE;
+    os->revalidate_series = TRUE;
+  }
+
+  g_hash_table_insert (priv->revalidations, os->url, os);
+  push_revalidation (os);
+}
+
+static void
+resolve_by_the_tvdb (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  os->show = lookup_show (self, grl_media_get_show (os->video));
+  if (os->show->failed) {
+    stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_RESOLVE);
+    resolve_poster (os);
+    return;
+  }
+
+  /* Series wide keys are only requested with the first episode of each show,
+   * the others wait for it and then only ask for their own data */
+  if (priv->bulk_fetch) {
+    if (os->show->media == NULL) {
+      if (os->show->resolving) {
+        g_queue_push_tail (&os->show->waiters, os);
+        os->show_link = os->show->waiters.tail;
+        return;
+      }
+
+      os->show->resolving = TRUE;
+      os->show_leader = TRUE;
+    }
+  }
+
+  push_tvdb_resolve (os);
+}
+
+static void
+resolve_video_summary_media (OperationSpec *os)
+{
+  stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_PARSE);
+
+  if (grl_media_get_show (os->video) != NULL) {
+    os->is_tv_show = TRUE;
+    totem_series_summary_set_basic_content (os->totem_series_summary, os->video);
+    resolve_by_the_tvdb (os);
+
+    return;
+  }
+
+  /* Movies and names that could not be parsed; nothing was asked to the
+   * metadata source, so this is not remembered as a failed lookup */
+  g_debug ("video type is not defined: %s", grl_media_get_url (os->video));
+  operation_spec_free (os);
+}
+
+static void
+resolve_by_video_title_parsing_done (GrlSource    *source,
+                                     guint         operation_id,
+                                     GrlMedia     *media,
+                                     gpointer      user_data,
+                                     const GError *error)
+{
+  OperationSpec *os = user_data;
+
+  if (!operation_spec_returned (os))
+    return;
+
+  totem_scheduler_done (os->totem_series_summary->priv->scheduler, source);
+  trace_queue (os->totem_series_summary, source);
+
+  if (error != NULL && schedule_retry (os, resolve_by_video_title_parsing)) {
+    g_debug ("video-title-parsing failed, retrying: %s", error->message);
+    return;
+  }
+
+  if (error != NULL) {
+    g_warning ("video-title-parsing failed: %s", error->message);
+    operation_spec_free (os);
+    return;
+  }
+
+  resolve_video_summary_media (os);
+}
+
+static void
+start_video_title_parsing (gpointer user_data)
+{
+  OperationSpec *os = user_data;
+  TotemSeriesSummaryPrivate *priv;
+  GrlOperationOptions *options;
+  GList *keys;
+  GrlCaps *caps;
+  guint op_id;
+
+  priv = os->totem_series_summary->priv;
+  caps = grl_source_get_caps (priv->video_title_parsing_source, GRL_OP_RESOLVE);
+  options = grl_operation_options_new (caps);
+  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
+
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_EPISODE_TITLE,
+                                    GRL_METADATA_KEY_SHOW,
+                                    GRL_METADATA_KEY_SEASON,
+                                    GRL_METADATA_KEY_EPISODE,
+                                    GRL_METADATA_KEY_INVALID);
+
+  /* We want to extract all metadata from file's name */
+  grl_data_set_boolean (GRL_DATA (os->video),
+                        GRL_METADATA_KEY_TITLE_FROM_FILENAME,
+                        TRUE);
+  os->busy = TRUE;
+  os->grl_source = priv->video_title_parsing_source;
+  op_id = grl_source_resolve (priv->video_title_parsing_source,
+                              os->video,
+                              keys,
+                              options,
+                              resolve_by_video_title_parsing_done,
+                              os);
+  g_object_unref (options);
+  g_list_free (keys);
+
+  os->grl_op_id = op_id;
+}
+
+static void
+resolve_by_video_title_parsing (OperationSpec *os)
+{
+  TotemSeriesSummary *self = os->totem_series_summary;
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  /* The season is not known yet */
+  totem_scheduler_push (priv->scheduler,
+                        priv->video_title_parsing_source,
+                        TOTEM_SCHEDULER_PRIORITY_DEFAULT,
+                        TOTEM_SCHEDULER_NO_GROUP,
+                        start_video_title_parsing,
+                        os);
+  trace_queue (self, priv->video_title_parsing_source);
+}
+
+static TotemSchedulerPriority
+reprioritize_job (gint                   group,
+                  TotemSchedulerPriority priority,
+                  gpointer               user_data)
+{
+  /* Title parsing and revalidations keep theirs */
+  if (group == TOTEM_SCHEDULER_NO_GROUP)
+    return priority;
+
+  return get_group_priority (user_data, group);
+}
+
+static void
+prioritize_season (TotemSeriesSummary *self,
+                   ShowData           *show,
+                   gint                season)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  if (priv->visible_show == show && priv->visible_season == season)
+    return;
+
+  priv->visible_show = show;
+  priv->visible_season = season;
+  totem_scheduler_reprioritize_all (priv->scheduler, reprioritize_job, self);
+}
+
+static void
+season_changed_cb (TotemSeriesView *view,
+                   gint             season,
+                   ShowData        *show)
+{
+  show->visible_season = season;
+  if (show == show->summary->priv->visible_show)
+    prioritize_season (show->summary, show, season);
+}
+
+static void
+visible_show_changed_cb (GObject            *stack,
+                         GParamSpec         *pspec,
+                         TotemSeriesSummary *self)
+{
+  GtkWidget *child;
+  GHashTableIter iter;
+  ShowData *show;
+
+  child = gtk_stack_get_visible_child (GTK_STACK (stack));
+  g_hash_table_iter_init (&iter, self->priv->shows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &show)) {
+    if (child != NULL && GTK_WIDGET (show->view) == child) {
+      gint season = show->visible_season;
+
+      if (self->priv->pending_season >= 0) {
+        season = self->priv->pending_season;
+        self->priv->pending_season = -1;
+      }
+      prioritize_season (self, show, season);
+      return;
+    }
+  }
+}
+
+static void
+resolve_video (OperationSpec *os)
+{
+  TotemSeriesSummaryPrivate *priv = os->totem_series_summary->priv;
+  GrlMedia *video = os->video;
+
+  /* Warm start: no need to go through the network again, or only once
+   * the video is shown in cache first mode */
+  if (totem_metadata_cache_lookup (priv->metadata_cache, video)) {
+    gboolean stale = totem_metadata_cache_is_stale (priv->metadata_cache, video);
+
+    if (!stale || priv->cache_first) {
+      os->is_tv_show = (grl_media_get_show (video) != NULL);
+      os->from_cache = TRUE;
+      if (stale && os->is_tv_show)
+        revalidate_video (os->totem_series_summary, video);
+      resolve_poster (os);
+      return;
+    }
+
+    /* Otherwise resolved again, keeping the stale data if that fails */
+    os->stale = stale;
+  }
+
+  /* Nor for the videos that could not be resolved recently */
+  if (totem_metadata_cache_has_failed (priv->metadata_cache, video)) {
+    g_debug ("Skipping %s, it failed recently", grl_media_get_url (video));
+    operation_spec_free (os);
+    return;
+  }
+
+  /* Most file names are trivial and can be parsed right away, the Lua
+   * source is only needed for the others */
+  if (grl_media_get_show (video) == NULL && totem_title_parser_parse_media (video)) {
+    resolve_video_summary_media (os);
+  } else if (priv->video_title_parsing_source != NULL) {
+    resolve_by_video_title_parsing (os);
+  } else {
+    resolve_video_summary_media (os);
+  }
+}
+
+static void
+hash_done (GObject      *source_object,
+           GAsyncResult *res,
+           gpointer      user_data)
+{
+  OperationSpec *os = user_data;
+  GError *err = NULL;
+  gint64 size;
+  gchar *hash;
+
+  hash = totem_hash_pool_compute_finish (TOTEM_HASH_POOL (source_object), res, &size, &err);
+  if (!operation_spec_returned (os)) {
+    g_free (hash);
+    g_clear_error (&err);
+    return;
+  }
+
+  stage_finished (os, TOTEM_SERIES_SUMMARY_STAGE_HASH);
+
+  if (hash != NULL) {
+    grl_data_set_string (GRL_DATA (os->video),
+                         os->totem_series_summary->priv->gibest_hash_key,
+                         hash);
+    grl_media_set_size (os->video, size);
+    g_free (hash);
+  } else {
+    /* Not fatal, the video just can't be cached */
+    g_debug ("Failed to hash %s: %s", grl_media_get_url (os->video), err->message);
+    g_error_free (err);
+  }
+
+  resolve_video (os);
+}
+
+static gboolean
+needs_hash (TotemSeriesSummary *self,
+            GrlMedia           *video)
+{
+  const gchar *hash;
+
+  if (self->priv->gibest_hash_key == GRL_METADATA_KEY_INVALID)
+    return FALSE;
+
+  hash = grl_data_get_string (GRL_DATA (video), self->priv->gibest_hash_key);
+  return (hash == NULL || *hash == '\0' || grl_media_get_size (video) <= 0);
+}
+
+/* Urls can be paths, relative or not, or uris */
+static gchar *
+get_local_path (const gchar *url)
+{
+  GFile *file;
+  gchar *path;
+
+  file = g_file_new_for_commandline_arg (url);
+  path = g_file_get_path (file);
+  g_object_unref (file);
+
+  return path;
+}
+
+/* A directory tree being walked, one directory at a time. The next batch
+ * of files is always requested before handling the current one. */
+typedef struct
+{
+  GQueue           directories;
+  GFileEnumerator *enumerator;
+  gboolean         is_root;
+  GCancellable    *cancellable;
+  GCancellable    *caller_cancellable;
+  gulong           cancelled_id;
+  guint            n_videos;
+} ScanData;
+
+static void scan_next_directory (GTask *task);
+static void watch_directory (TotemSeriesSummary *self, GFile *directory);
+
+static void
+scan_data_free (ScanData *sd)
+{
+  GFile *dir;
+
+  while ((dir = g_queue_pop_head (&sd->directories)) != NULL)
+    g_object_unref (dir);
+  if (sd->caller_cancellable != NULL) {
+    g_cancellable_disconnect (sd->caller_cancellable, sd->cancelled_id);
+    g_object_unref (sd->caller_cancellable);
+  }
+  g_clear_object (&sd->enumerator);
+  g_clear_object (&sd->cancellable);
+  g_slice_free (ScanData, sd);
+}
+
+static void
+scan_cancelled_cb (GCancellable *caller_cancellable,
+                   GCancellable *cancellable)
+{
+  g_cancellable_cancel (cancellable);
+}
+
+static void
+scan_return (GTask  *task,
+             GError *error)
+{
+  TotemSeriesSummary *self = g_task_get_source_object (task);
+  ScanData *sd = g_task_get_task_data (task);
+
+  self->priv->scans = g_list_remove (self->priv->scans, sd);
+  if (error != NULL)
+    g_task_return_error (task, error);
+  else
+    g_task_return_int (task, sd->n_videos);
+  g_object_unref (task);
+}
+
+static gboolean
+is_video (GFileInfo *info)
+{
+  const gchar *content_type, *name;
+  gchar *mime;
+  gboolean video;
+  guint i;
+
+  content_type = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_FAST_CONTENT_TYPE);
+  if (content_type != NULL && !g_content_type_is_unknown (content_type)) {
+    mime = g_content_type_get_mime_type (content_type);
+    video = (mime != NULL && g_str_has_prefix (mime, "video/"));
+    g_free (mime);
+    if (video)
+      return TRUE;
+  }
+
+  name = g_file_info_get_name (info);
+  for (i = 0; video_extensions[i] != NULL; i++) {
+    if (g_str_has_suffix (name, video_extensions[i]))
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Paths where possible, as in totem_series_summary_add_video() */
+static gchar *
+get_file_url (GFile *file)
+{
+  gchar *url;
+
+  url = g_file_get_path (file);
+  if (url == NULL)
+    url = g_file_get_uri (file);
+  return url;
+}
+
+static GrlMedia *
+create_video (GFile     *file,
+              GFileInfo *info)
+{
+  GrlMedia *video;
+  gchar *url;
+
+  url = get_file_url (file);
+  video = grl_media_video_new ();
+  grl_media_set_url (video, url);
+  grl_media_set_size (video, g_file_info_get_size (info));
+  g_free (url);
+
+  /* Parsed while the next batch is being read */
+  totem_title_parser_parse_media (video);
+
+  return video;
+}
+
+static void
+scan_next_files_done (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  GFileEnumerator *enumerator = G_FILE_ENUMERATOR (source_object);
+  GTask *task = user_data;
+  ScanData *sd = g_task_get_task_data (task);
+  GPtrArray *videos;
+  GList *files, *it;
+  GError *err = NULL;
+
+  files = g_file_enumerator_next_files_finish (enumerator, res, &err);
+  if (err != NULL) {
+    gchar *name;
+
+    if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      scan_return (task, err);
+      return;
+    }
+
+    name = g_file_get_parse_name (g_file_enumerator_get_container (enumerator));
+    g_warning ("Failed to read %s: %s", name, err->message);
+    g_error_free (err);
+    g_free (name);
+  }
+
+  if (files == NULL) {
+    g_clear_object (&sd->enumerator);
+    scan_next_directory (task);
+    return;
+  }
+
+  /* Keep the I/O going meanwhile */
+  g_file_enumerator_next_files_async (enumerator, SCAN_BATCH_SIZE, G_PRIORITY_LOW,
+                                      sd->cancellable, scan_next_files_done, task);
+
+  videos = g_ptr_array_new_with_free_func (g_object_unref);
+  for (it = files; it != NULL; it = it->next) {
+    GFileInfo *info = it->data;
+    GFile *child;
+
+    if (g_file_info_get_is_hidden (info))
+      continue;
+
+    child = g_file_enumerator_get_child (enumerator, info);
+    if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+      g_queue_push_tail (&sd->directories, g_object_ref (child));
+    else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR && is_video (info))
+      g_ptr_array_add (videos, create_video (child, info));
+    g_object_unref (child);
+  }
+  g_list_free_full (files, g_object_unref);
+
+  sd->n_videos += totem_series_summary_add_videos (g_task_get_source_object (task), videos);
+  g_ptr_array_unref (videos);
+}
+
+static void
+scan_enumerate_done (GObject      *source_object,
+                     GAsyncResult *res,
+                     gpointer      user_data)
+{
+  GTask *task = user_data;
+  ScanData *sd = g_task_get_task_data (task);
+  GError *err = NULL;
+
+  sd->enumerator = g_file_enumerate_children_finish (G_FILE (source_object), res, &err);
+  if (sd->enumerator == NULL) {
+    gchar *name;
+
+    /* Unreadable subdirectories are skipped */
+    if (sd->is_root || g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+      scan_return (task, err);
+      return;
+    }
+
+    name = g_file_get_parse_name (G_FILE (source_object));
+    g_debug ("Failed to open %s: %s", name, err->message);
+    g_error_free (err);
+    g_free (name);
+    scan_next_directory (task);
+    return;
+  }
+
+  sd->is_root = FALSE;
+  watch_directory (g_task_get_source_object (task), G_FILE (source_object));
+  g_file_enumerator_next_files_async (sd->enumerator, SCAN_BATCH_SIZE, G_PRIORITY_LOW,
+                                      sd->cancellable, scan_next_files_done, task);
+}
+
+static void
+scan_next_directory (GTask *task)
+{
+  ScanData *sd = g_task_get_task_data (task);
+  GFile *dir;
+
+  dir = g_queue_pop_head (&sd->directories);
+  if (dir == NULL) {
+    scan_return (task, NULL);
+    return;
+  }
+
+  g_file_enumerate_children_async (dir, SCAN_ATTRIBUTES, G_FILE_QUERY_INFO_NONE,
+                                   G_PRIORITY_LOW, sd->cancellable,
+                                   scan_enumerate_done, task);
+  g_object_unref (dir);
+}
+
+static void
+cancel_all_scans (TotemSeriesSummary *self)
+{
+  GList *it;
+
+  for (it = self->priv->scans; it != NULL; it = it->next) {
+    ScanData *sd = it->data;
+
+    g_cancellable_cancel (sd->cancellable);
+  }
+}
+
+static void
+monitor_changed_cb (GFileMonitor       *monitor,
+                    GFile              *file,
+                    GFile              *other_file,
+                    GFileMonitorEvent   event,
+                    TotemSeriesSummary *self);
+
+static void
+monitor_free (GFileMonitor *monitor)
+{
+  g_signal_handlers_disconnect_matched (monitor, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
+                                        monitor_changed_cb, NULL);
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+/* GFileMonitor is not recursive, every directory walked gets its own */
+static void
+watch_directory (TotemSeriesSummary *self,
+                 GFile              *directory)
+{
+  GFileMonitor *monitor;
+  GError *err = NULL;
+
+  if (!self->priv->watch || g_hash_table_contains (self->priv->monitors, directory))
+    return;
+
+  monitor = g_file_monitor_directory (directory, G_FILE_MONITOR_WATCH_MOVES, NULL, &err);
+  if (monitor == NULL) {
+    gchar *name = g_file_get_parse_name (directory);
+
+    g_warning ("Failed to watch %s: %s", name, err->message);
+    g_error_free (err);
+    g_free (name);
+    return;
+  }
+
+  g_signal_connect (monitor, "changed", G_CALLBACK (monitor_changed_cb), self);
+  g_hash_table_insert (self->priv->monitors, g_object_ref (directory), monitor);
+}
+
+/* @directory was deleted or moved away, with everything below it */
+static void
+remove_videos_under (TotemSeriesSummary *self,
+                     GFile              *directory)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  GHashTableIter iter;
+  GPtrArray *videos;
+  GList *shown, *it;
+  GFile *watched;
+  OperationSpec *os;
+  ShowData *show;
+  gchar *url, *prefix;
+  guint i;
+
+  g_hash_table_iter_init (&iter, priv->monitors);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &watched, NULL)) {
+    if (g_file_equal (watched, directory) || g_file_has_prefix (watched, directory))
+      g_hash_table_iter_remove (&iter);
+  }
+
+  url = get_file_url (directory);
+  prefix = g_strconcat (url, "/", NULL);
+  g_free (url);
 
-  if (os->is_tv_show)
-    title = grl_media_get_show (media);
-  else
-    title = grl_media_get_title (media);
+  /* Collected first, removing changes the tables */
+  videos = g_ptr_array_new_with_free_func (g_object_unref);
+  g_hash_table_iter_init (&iter, priv->shows);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &show)) {
+    if (show->view == NULL)
+      continue;
 
-  if (title == NULL) {
-    g_warning ("Basic information is missing - no title");
-    operation_spec_free (os);
-    return;
-  }
+    shown = totem_series_view_get_episodes (show->view);
+    for (it = shown; it != NULL; it = it->next) {
+      const TotemEpisode *episode = it->data;
+      GrlMedia *video;
 
-  if (os->is_tv_show)
-    poster_url = grl_data_get_string (GRL_DATA (media), priv->tvdb_poster_key);
-  else
-    poster_url = grl_data_get_string (GRL_DATA (media), priv->tmdb_poster_key);
-
-  if (poster_url != NULL) {
-    os->poster_path = g_build_filename (g_get_tmp_dir (), title, NULL);
-    if (!g_file_test (os->poster_path, G_FILE_TEST_EXISTS)) {
-      GrlNetWc *wc = grl_net_wc_new ();
-      grl_net_wc_request_async (wc, poster_url, NULL, resolve_poster_done, os);
-      g_object_unref (wc);
-      return;
+      if (!g_str_has_prefix (episode->url, prefix))
+        continue;
+
+      video = grl_media_video_new ();
+      grl_media_set_url (video, episode->url);
+      g_ptr_array_add (videos, video);
     }
+    g_list_free (shown);
   }
 
-  add_video_to_summary_and_free (os);
-}
+  g_hash_table_iter_init (&iter, priv->operations);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &os)) {
+    if (g_str_has_prefix (os->url, prefix))
+      g_ptr_array_add (videos, g_object_ref (os->video));
+  }
 
-static void
-resolve_by_the_tvdb (OperationSpec *os)
-{
-  TotemSeriesSummaryPrivate *priv;
-  GrlOperationOptions *options;
-  GList *keys;
-  GrlCaps *caps;
-  guint op_id;
+  for (i = 0; i < priv->ready_videos->len; i++) {
+    GrlMedia *ready = g_ptr_array_index (priv->ready_videos, i);
 
-  priv = os->totem_series_summary->priv;
-  caps = grl_source_get_caps (priv->tvdb_source, GRL_OP_RESOLVE);
-  options = grl_operation_options_new (caps);
-  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
+    if (g_str_has_prefix (grl_media_get_url (ready), prefix))
+      g_ptr_array_add (videos, g_object_ref (ready));
+  }
 
-  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_DESCRIPTION,
-                                    GRL_METADATA_KEY_PERFORMER,
-                                    GRL_METADATA_KEY_DIRECTOR,
-                                    GRL_METADATA_KEY_AUTHOR,
-                                    GRL_METADATA_KEY_GENRE,
-                                    GRL_METADATA_KEY_PUBLICATION_DATE,
-                                    GRL_METADATA_KEY_EPISODE_TITLE,
-                                    priv->tvdb_poster_key,
-                                    GRL_METADATA_KEY_INVALID);
-  op_id = grl_source_resolve (priv->tvdb_source,
-                              os->video,
-                              keys,
-                              options,
-                              resolve_metadata_done,
-                              os);
-  g_object_unref (options);
-  g_list_free (keys);
+  for (i = 0; i < videos->len; i++)
+    totem_series_summary_remove_video (self, g_ptr_array_index (videos, i));
 
-  os->pending_grl_ops = g_list_prepend (os->pending_grl_ops,
-                                        GUINT_TO_POINTER (op_id));
+  g_ptr_array_unref (videos);
+  g_free (prefix);
 }
 
 static void
-resolve_video_summary_media (OperationSpec *os)
+watch_query_info_done (GObject      *source_object,
+                       GAsyncResult *res,
+                       gpointer      user_data)
 {
-  if (grl_media_get_show (os->video) != NULL) {
-    os->is_tv_show = TRUE;
-    totem_series_summary_set_basic_content (os->totem_series_summary, os->video);
-    resolve_by_the_tvdb (os);
+  TotemSeriesSummary *self = user_data;
+  GFile *file = G_FILE (source_object);
+  GFileInfo *info;
+  GError *err = NULL;
 
+  info = g_file_query_info_finish (file, res, &err);
+  if (info == NULL) {
+    /* Gone again before the burst ended */
+    if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+      g_debug ("Failed to query new file: %s", err->message);
+    g_error_free (err);
+    g_object_unref (self);
     return;
   }
 
-  g_warning ("video type is not defined: %s", grl_media_get_url (os->video));
-  operation_spec_free (os);
+  if (g_file_info_get_is_hidden (info)) {
+    /* Skipped as when walking the library */
+  } else if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) {
+    totem_series_summary_add_directory_async (self, file, self->priv->watch_cancellable,
+                                              NULL, NULL);
+  } else if (g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR && is_video (info)) {
+    GrlMedia *video = create_video (file, info);
+
+    totem_series_summary_add_video (self, video);
+    g_object_unref (video);
+  }
+
+  g_object_unref (info);
+  g_object_unref (self);
 }
 
-static void
-resolve_by_video_title_parsing_done (GrlSource    *source,
-                                     guint         operation_id,
-                                     GrlMedia     *media,
-                                     gpointer      user_data,
-                                     const GError *error)
+/* Apply the changes of a burst of file events at once */
+static gboolean
+flush_watch_changes (gpointer user_data)
 {
-  OperationSpec *os = user_data;
-
-  os->pending_grl_ops = g_list_remove (os->pending_grl_ops,
-                                       GUINT_TO_POINTER (operation_id));
-  if (error != NULL) {
-    g_warning ("video-title-parsing failed: %s", error->message);
-    operation_spec_free (os);
-    return;
+  TotemSeriesSummary *self = user_data;
+  TotemSeriesSummaryPrivate *priv = self->priv;
+  GHashTableIter iter;
+  GFile *file;
+
+  priv->watch_flush_id = 0;
+  g_debug ("Library changed: %u files added, %u removed",
+           g_hash_table_size (priv->pending_added),
+           g_hash_table_size (priv->pending_removed));
+
+  g_hash_table_iter_init (&iter, priv->pending_removed);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL)) {
+    if (g_hash_table_contains (priv->monitors, file)) {
+      remove_videos_under (self, file);
+    } else {
+      GrlMedia *video;
+      gchar *url;
+
+      url = get_file_url (file);
+      video = grl_media_video_new ();
+      grl_media_set_url (video, url);
+      totem_series_summary_remove_video (self, video);
+      g_object_unref (video);
+      g_free (url);
+    }
   }
+  g_hash_table_remove_all (priv->pending_removed);
+
+  /* New files are only looked at once they stopped changing */
+  g_hash_table_iter_init (&iter, priv->pending_added);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL)) {
+    g_file_query_info_async (file, SCAN_ATTRIBUTES, G_FILE_QUERY_INFO_NONE,
+                             G_PRIORITY_LOW, priv->watch_cancellable,
+                             watch_query_info_done, g_object_ref (self));
+  }
+  g_hash_table_remove_all (priv->pending_added);
 
-  resolve_video_summary_media (os);
+  return G_SOURCE_REMOVE;
 }
 
 static void
-resolve_by_video_title_parsing (OperationSpec *os)
+watch_file_added (TotemSeriesSummary *self,
+                  GFile              *file)
 {
-  TotemSeriesSummaryPrivate *priv;
-  GrlOperationOptions *options;
-  GList *keys;
-  GrlCaps *caps;
-  guint op_id;
-
-  priv = os->totem_series_summary->priv;
-  caps = grl_source_get_caps (priv->video_title_parsing_source, GRL_OP_RESOLVE);
-  options = grl_operation_options_new (caps);
-  grl_operation_options_set_resolution_flags (options, GRL_RESOLVE_NORMAL);
-
-  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
-                                    GRL_METADATA_KEY_EPISODE_TITLE,
-                                    GRL_METADATA_KEY_SHOW,
-                                    GRL_METADATA_KEY_SEASON,
-                                    GRL_METADATA_KEY_EPISODE,
-                                    GRL_METADATA_KEY_INVALID);
-
-  /* We want to extract all metadata from file's name */
-  grl_data_set_boolean (GRL_DATA (os->video),
-                        GRL_METADATA_KEY_TITLE_FROM_FILENAME,
-                        TRUE);
-  op_id = grl_source_resolve (priv->video_title_parsing_source,
-                              os->video,
-                              keys,
-                              options,
-                              resolve_by_video_title_parsing_done,
-                              os);
-  g_object_unref (options);
-  g_list_free (keys);
-
-  os->pending_grl_ops = g_list_prepend (os->pending_grl_ops,
-                                        GUINT_TO_POINTER (op_id));
+  g_hash_table_add (self->priv->pending_added, g_object_ref (file));
 }
 
-/* For GrlKeys that have several values, return all of them in one
- * string separated by comma; */
-static gchar *
-get_data_from_media (GrlData *data,
-                     GrlKeyID key)
+/* Kept as removed even if it comes back, a replaced file is a new one */
+static void
+watch_file_removed (TotemSeriesSummary *self,
+                    GFile              *file)
 {
-  gint i, len;
-  GString *s;
+  g_hash_table_remove (self->priv->pending_added, file);
+  g_hash_table_add (self->priv->pending_removed, g_object_ref (file));
+}
 
-  len = grl_data_length (data, key);
-  if (len <= 0)
-    return NULL;
+static void
+monitor_changed_cb (GFileMonitor       *monitor,
+                    GFile              *file,
+                    GFile              *other_file,
+                    GFileMonitorEvent   event,
+                    TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
+
+  switch (event) {
+  case G_FILE_MONITOR_EVENT_CREATED:
+  case G_FILE_MONITOR_EVENT_MOVED_IN:
+    watch_file_added (self, file);
+    break;
+  case G_FILE_MONITOR_EVENT_DELETED:
+  case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    watch_file_removed (self, file);
+    break;
+  case G_FILE_MONITOR_EVENT_RENAMED:
+    watch_file_removed (self, file);
+    watch_file_added (self, other_file);
+    break;
+  case G_FILE_MONITOR_EVENT_CHANGED:
+  case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    /* A new file still being written delays the update */
+    if (!g_hash_table_contains (priv->pending_added, file))
+      return;
+    break;
+  default:
+    return;
+  }
 
-  s = g_string_new ("");
-  for (i = 0; i < len; i++) {
-    GrlRelatedKeys *relkeys;
-    const gchar *element;
+  if (priv->watch_flush_id != 0)
+    g_source_remove (priv->watch_flush_id);
+  priv->watch_flush_id = g_timeout_add (WATCH_DEBOUNCE_MS, flush_watch_changes, self);
+}
 
-    relkeys = grl_data_get_related_keys (data, key, i);
-    element = grl_related_keys_get_string (relkeys, key);
+static void
+cancel_watch_changes (TotemSeriesSummary *self)
+{
+  TotemSeriesSummaryPrivate *priv = self->priv;
 
-    if (i > 0)
-      g_string_append (s, ", ");
-    g_string_append (s, element);
+  if (priv->watch_flush_id != 0) {
+    g_source_remove (priv->watch_flush_id);
+    priv->watch_flush_id = 0;
   }
-  return g_string_free (s, FALSE);
+  g_hash_table_remove_all (priv->pending_added);
+  g_hash_table_remove_all (priv->pending_removed);
+
+  g_cancellable_cancel (priv->watch_cancellable);
+  g_object_unref (priv->watch_cancellable);
+  priv->watch_cancellable = g_cancellable_new ();
 }
 
 /* -------------------------------------------------------------------------- *
@@ -415,6 +2315,7 @@ totem_series_summary_new (void)
   TotemSeriesSummaryPrivate *priv;
   GrlSource *source;
   GrlRegistry *registry;
+  GList *keys;
 
   self = g_object_new (TOTEM_TYPE_SERIES_SUMMARY, NULL);
   priv = self->priv;
@@ -465,6 +2366,56 @@ totem_series_summary_new (void)
 /*    g_warning ("Opensubtitles not available");*/
   }
 
+  /* Usually registered by grl-opensubtitles or grl-local-metadata */
+  priv->gibest_hash_key = grl_registry_lookup_metadata_key (registry, "gibest-hash");
+  if (priv->gibest_hash_key == GRL_METADATA_KEY_INVALID) {
+    GParamSpec *spec;
+
+    spec = g_param_spec_string ("gibest-hash",
+                                "Gibest hash",
+                                "Gibest hash of the video file",
+                                NULL,
+                                G_PARAM_STATIC_STRINGS | G_PARAM_READWRITE);
+    priv->gibest_hash_key = grl_registry_register_metadata_key (registry, spec,
+                                                                GRL_METADATA_KEY_INVALID,
+                                                                NULL);
+  }
+  priv->hash_pool = totem_hash_pool_new (NULL, 0);
+
+  /* Everything the pipeline resolves, so a cached video skips it */
+  keys = grl_metadata_key_list_new (GRL_METADATA_KEY_TITLE,
+                                    GRL_METADATA_KEY_SHOW,
+                                    GRL_METADATA_KEY_SEASON,
+                                    GRL_METADATA_KEY_EPISODE,
+                                    GRL_METADATA_KEY_EPISODE_TITLE,
+                                    GRL_METADATA_KEY_DESCRIPTION,
+                                    GRL_METADATA_KEY_PERFORMER,
+                                    GRL_METADATA_KEY_DIRECTOR,
+                                    GRL_METADATA_KEY_AUTHOR,
+                                    GRL_METADATA_KEY_GENRE,
+                                    GRL_METADATA_KEY_PUBLICATION_DATE,
+                                    GRL_METADATA_KEY_INVALID);
+  if (priv->tvdb_poster_key != GRL_METADATA_KEY_INVALID)
+    keys = g_list_append (keys, GRLKEYID_TO_POINTER (priv->tvdb_poster_key));
+  priv->metadata_cache = totem_metadata_cache_new (NULL, keys);
+  g_list_free (keys);
+
+  priv->poster_cache = totem_poster_cache_new (NULL, 0);
+  priv->subtitle_cache = totem_subtitle_cache_new (NULL);
+
+  priv->series_keys = grl_metadata_key_list_new (GRL_METADATA_KEY_DESCRIPTION,
+                                                 GRL_METADATA_KEY_PERFORMER,
+                                                 GRL_METADATA_KEY_DIRECTOR,
+                                                 GRL_METADATA_KEY_AUTHOR,
+                                                 GRL_METADATA_KEY_GENRE,
+                                                 GRL_METADATA_KEY_INVALID);
+  if (priv->tvdb_poster_key != GRL_METADATA_KEY_INVALID)
+    priv->series_keys = g_list_append (priv->series_keys,
+                                       GRLKEYID_TO_POINTER (priv->tvdb_poster_key));
+  priv->episode_keys = grl_metadata_key_list_new (GRL_METADATA_KEY_PUBLICATION_DATE,
+                                                  GRL_METADATA_KEY_EPISODE_TITLE,
+                                                  GRL_METADATA_KEY_INVALID);
+
   return self;
 }
 
@@ -491,45 +2442,375 @@ totem_series_summary_add_video (TotemSeriesSummary *self,
   }
 #endif
 
+  if (g_hash_table_contains (self->priv->operations, url)) {
+    g_debug ("Video is being resolved already: %s", url);
+    return FALSE;
+  }
+
   os = g_slice_new0 (OperationSpec);
   os->totem_series_summary = self;
   os->video = g_object_ref (video);
-  self->priv->pending_ops = g_list_prepend (self->priv->pending_ops, os);
-  if (self->priv->video_title_parsing_source != NULL) {
-    resolve_by_video_title_parsing (os);
-  } else {
-    resolve_video_summary_media (os);
+  os->url = g_strdup (url);
+  os->cancellable = g_cancellable_new ();
+  os->stage_start = g_get_monotonic_time ();
+  g_hash_table_insert (self->priv->operations, os->url, os);
+
+  if (needs_hash (self, video)) {
+    gchar *path = get_local_path (url);
+
+    if (path != NULL) {
+      /* Done in a worker thread, then the pipeline goes on */
+      os->busy = TRUE;
+      totem_hash_pool_compute_async (self->priv->hash_pool, path, os->cancellable,
+                                     hash_done, os);
+      g_free (path);
+      return TRUE;
+    }
   }
+
+  resolve_video (os);
   return TRUE;
 }
 
+/* Number of threads hashing video files; tune against disk bandwidth with
+ * totem_series_summary_get_hash_stats() */
+void
+totem_series_summary_set_hash_threads (TotemSeriesSummary *self,
+                                       gint                n_threads)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  totem_hash_pool_set_max_threads (self->priv->hash_pool, n_threads);
+}
+
+void
+totem_series_summary_get_hash_stats (TotemSeriesSummary *self,
+                                     TotemHashPoolStats *stats)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  totem_hash_pool_get_stats (self->priv->hash_pool, stats);
+}
+
+/* Limit the number of simultaneous operations on the grilo source
+ * @source_id, e.g. "grl-thetvdb" */
+void
+totem_series_summary_set_max_in_flight (TotemSeriesSummary *self,
+                                        const gchar        *source_id,
+                                        guint               max_in_flight)
+{
+  GrlSource *source;
+
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+  g_return_if_fail (source_id != NULL);
+
+  source = grl_registry_lookup_source (self->priv->registry, source_id);
+  if (source == NULL) {
+    g_warning ("Source %s not found", source_id);
+    return;
+  }
+
+  totem_scheduler_set_max_in_flight (self->priv->scheduler, source, max_in_flight);
+}
+
+/* Resolve the episodes of @season of the visible show before any other,
+ * then the seasons next to it and only then the rest of the library.
+ * Done automatically when the user switches to a show or a season. While
+ * no show is visible @season applies to the next one shown. */
+void
+totem_series_summary_prioritize_season (TotemSeriesSummary *self,
+                                        gint                season)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  if (self->priv->visible_show == NULL) {
+    self->priv->pending_season = season;
+    return;
+  }
+
+  prioritize_season (self, self->priv->visible_show, season);
+}
+
+/* Time spent by the videos in @stage so far */
+void
+totem_series_summary_get_stage_stats (TotemSeriesSummary           *self,
+                                      TotemSeriesSummaryStage       stage,
+                                      TotemSeriesSummaryStageStats *stats)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+  g_return_if_fail (stage < TOTEM_SERIES_SUMMARY_N_STAGES);
+  g_return_if_fail (stats != NULL);
+
+  *stats = self->priv->stage_stats[stage];
+}
+
+/* Operations waiting for a slot of the grilo source @source_id */
+guint
+totem_series_summary_get_queue_depth (TotemSeriesSummary *self,
+                                      const gchar        *source_id)
+{
+  GrlSource *source;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_SUMMARY (self), 0);
+  g_return_val_if_fail (source_id != NULL, 0);
+
+  source = grl_registry_lookup_source (self->priv->registry, source_id);
+  if (source == NULL)
+    return 0;
+
+  return totem_scheduler_get_queued (self->priv->scheduler, source);
+}
+
+/* When enabled, the default, series wide metadata such as description,
+ * cast or poster is only resolved once per show */
+void
+totem_series_summary_set_bulk_fetch (TotemSeriesSummary *self,
+                                     gboolean            bulk_fetch)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  self->priv->bulk_fetch = bulk_fetch;
+}
+
+/* Feed a whole library into the pipeline in one call. Videos are shown in
+ * batches as they are resolved. Returns the number of videos accepted. */
+guint
+totem_series_summary_add_videos (TotemSeriesSummary *self,
+                                 GPtrArray          *videos)
+{
+  guint i, added;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_SUMMARY (self), 0);
+  g_return_val_if_fail (videos != NULL, 0);
+
+  added = 0;
+  for (i = 0; i < videos->len; i++) {
+    if (totem_series_summary_add_video (self, g_ptr_array_index (videos, i)))
+      added++;
+  }
+  return added;
+}
+
+/* Walk @directory and its subdirectories in the background, adding every
+ * video file found to the summary as soon as it is read. */
+void
+totem_series_summary_add_directory_async (TotemSeriesSummary  *self,
+                                          GFile               *directory,
+                                          GCancellable        *cancellable,
+                                          GAsyncReadyCallback  callback,
+                                          gpointer             user_data)
+{
+  ScanData *sd;
+  GTask *task;
+
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+  g_return_if_fail (G_IS_FILE (directory));
+
+  sd = g_slice_new0 (ScanData);
+  g_queue_init (&sd->directories);
+  g_queue_push_tail (&sd->directories, g_object_ref (directory));
+  sd->is_root = TRUE;
+
+  /* Also cancelled by totem_series_summary_cancel() */
+  sd->cancellable = g_cancellable_new ();
+  if (cancellable != NULL) {
+    sd->caller_cancellable = g_object_ref (cancellable);
+    sd->cancelled_id = g_cancellable_connect (cancellable, G_CALLBACK (scan_cancelled_cb),
+                                              sd->cancellable, NULL);
+  }
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_task_data (task, sd, (GDestroyNotify) scan_data_free);
+  self->priv->scans = g_list_prepend (self->priv->scans, sd);
+
+  scan_next_directory (task);
+}
+
+/* Returns the number of videos added, or -1 on error */
+gint
+totem_series_summary_add_directory_finish (TotemSeriesSummary  *self,
+                                           GAsyncResult        *res,
+                                           GError             **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), -1);
+
+  return g_task_propagate_int (G_TASK (res), error);
+}
+
+/* Stop resolving @video, if it is still pending, or remove it from the
+ * view. Videos are matched by url. */
+gboolean
+totem_series_summary_remove_video (TotemSeriesSummary *self,
+                                   GrlMedia           *video)
+{
+  TotemSeriesSummaryPrivate *priv;
+  GHashTableIter iter;
+  OperationSpec *os;
+  ShowData *show;
+  const gchar *url;
+  gboolean removed;
+  guint i;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_SUMMARY (self), FALSE);
+  g_return_val_if_fail (video != NULL, FALSE);
+
+  priv = self->priv;
+  url = grl_media_get_url (video);
+  if (url == NULL)
+    return FALSE;
+
+  os = g_hash_table_lookup (priv->revalidations, url);
+  if (os != NULL)
+    operation_spec_cancel (os);
+
+  os = g_hash_table_lookup (priv->subtitle_lookups, url);
+  if (os != NULL)
+    operation_spec_cancel (os);
+  g_hash_table_remove (priv->subtitles, url);
+
+  removed = FALSE;
+  os = g_hash_table_lookup (priv->operations, url);
+  if (os != NULL) {
+    operation_spec_cancel (os);
+    removed = TRUE;
+  }
+
+  for (i = 0; !removed && i < priv->ready_videos->len; i++) {
+    GrlMedia *ready = g_ptr_array_index (priv->ready_videos, i);
+
+    if (g_strcmp0 (grl_media_get_url (ready), url) == 0) {
+      g_ptr_array_remove_index (priv->ready_videos, i);
+      g_ptr_array_remove_index (priv->ready_shows, i);
+      g_array_remove_index (priv->ready_times, i);
+      removed = TRUE;
+    }
+  }
+
+  /* The show of @video might not be known */
+  g_hash_table_iter_init (&iter, priv->shows);
+  while (!removed && g_hash_table_iter_next (&iter, NULL, (gpointer *) &show)) {
+    if (show->view != NULL && totem_series_view_remove_video (show->view, video))
+      removed = TRUE;
+  }
+
+  return removed;
+}
+
+/* When enabled, the default, videos with stale cached metadata are shown
+ * right away and resolved again in the background, updating the rows that
+ * changed. Otherwise they are resolved first, and shown from the stale
+ * metadata only if that fails. */
+void
+totem_series_summary_set_cache_first (TotemSeriesSummary *self,
+                                      gboolean            cache_first)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  self->priv->cache_first = cache_first;
+}
+
+/* Cancel every pending operation: directory scans, metadata requests,
+ * poster and subtitle downloads and hashing. Videos shown already are kept, and so
+ * are the watches; only the file changes not applied yet are dropped. */
+void
+totem_series_summary_cancel (TotemSeriesSummary *self)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  cancel_watch_changes (self);
+  cancel_all_scans (self);
+  cancel_all_operations (self);
+}
+
+/* In watch mode, the directories added from now on are monitored: new
+ * video files go through the pipeline and deleted ones leave the view.
+ * Bursts of events, e.g. a large copy, are applied at once when they end. */
+void
+totem_series_summary_set_watch (TotemSeriesSummary *self,
+                                gboolean            watch)
+{
+  TotemSeriesSummaryPrivate *priv;
+
+  g_return_if_fail (TOTEM_IS_SERIES_SUMMARY (self));
+
+  priv = self->priv;
+  if (priv->watch == watch)
+    return;
+
+  priv->watch = watch;
+  if (!watch) {
+    cancel_watch_changes (self);
+    g_hash_table_remove_all (priv->monitors);
+  }
+}
+
 /* -------------------------------------------------------------------------- *
  * Object
  * -------------------------------------------------------------------------- */
 
 static void
-totem_series_summary_finalize (GObject *object)
+totem_series_summary_dispose (GObject *object)
 {
-  TotemSeriesSummaryPrivate *priv = TOTEM_SERIES_SUMMARY (object)->priv;
+  /* Scans and file queries hold a reference on the summary until they stop */
+  totem_series_summary_set_watch (TOTEM_SERIES_SUMMARY (object), FALSE);
+  cancel_all_scans (TOTEM_SERIES_SUMMARY (object));
 
-  if (priv->pending_ops) {
-    GList *it = priv->pending_ops;
+  /* A destroyed summary might be kept alive by references, nothing should
+   * run for it anymore. Running operations are released on their
+   * callbacks. */
+  cancel_all_operations (TOTEM_SERIES_SUMMARY (object));
+  cancel_flush (TOTEM_SERIES_SUMMARY (object));
 
-    /* Cancel all pending operations and release its data */
-    while (it != NULL) {
-      GList *next = it->next;
-      OperationSpec *os = it->data;
-      GList *it_os;
+  G_OBJECT_CLASS (totem_series_summary_parent_class)->dispose (object);
+}
 
-      for (it_os = os->pending_grl_ops; it_os != NULL; it_os = it_os->next) {
-        grl_operation_cancel (GPOINTER_TO_UINT (it_os->data));
-      }
-      g_clear_pointer (&os->pending_grl_ops, g_list_free);
-      operation_spec_free (os);
-      it = next;
-    }
-    g_warn_if_fail (priv->pending_ops == NULL);
+/* The frame clock stops with the summary hidden, videos waiting for it
+ * are flushed from an idle instead */
+static void
+totem_series_summary_unmap (GtkWidget *widget)
+{
+  TotemSeriesSummary *self = TOTEM_SERIES_SUMMARY (widget);
+
+  GTK_WIDGET_CLASS (totem_series_summary_parent_class)->unmap (widget);
+
+  if (self->priv->flush_id != 0) {
+    cancel_flush (self);
+    queue_flush (self);
   }
+}
+
+static void
+totem_series_summary_finalize (GObject *object)
+{
+  TotemSeriesSummaryPrivate *priv = TOTEM_SERIES_SUMMARY (object)->priv;
+
+  g_warn_if_fail (g_hash_table_size (priv->operations) == 0);
+  g_clear_pointer (&priv->operations, g_hash_table_unref);
+  g_warn_if_fail (g_hash_table_size (priv->revalidations) == 0);
+  g_clear_pointer (&priv->revalidations, g_hash_table_unref);
+  g_warn_if_fail (g_hash_table_size (priv->subtitle_lookups) == 0);
+  g_clear_pointer (&priv->subtitle_lookups, g_hash_table_unref);
+  g_clear_pointer (&priv->subtitles, g_hash_table_unref);
+  g_clear_object (&priv->subtitle_cancellable);
+
+  g_clear_pointer (&priv->monitors, g_hash_table_unref);
+  g_clear_pointer (&priv->pending_added, g_hash_table_unref);
+  g_clear_pointer (&priv->pending_removed, g_hash_table_unref);
+  g_clear_object (&priv->watch_cancellable);
+
+  g_clear_pointer (&priv->ready_videos, g_ptr_array_unref);
+  g_clear_pointer (&priv->ready_shows, g_ptr_array_unref);
+  g_clear_pointer (&priv->ready_times, g_array_unref);
+  g_clear_object (&priv->metadata_cache);
+  g_clear_object (&priv->poster_cache);
+  g_clear_object (&priv->subtitle_cache);
+  g_clear_object (&priv->hash_pool);
+  g_clear_pointer (&priv->shows, g_hash_table_unref);
+  g_clear_object (&priv->scheduler);
+  g_clear_pointer (&priv->series_keys, g_list_free);
+  g_clear_pointer (&priv->episode_keys, g_list_free);
+
+  totem_trace_flush ();
 
   G_OBJECT_CLASS (totem_series_summary_parent_class)->finalize (object);
 }
@@ -539,6 +2820,32 @@ totem_series_summary_init (TotemSeriesSummary *self)
 {
   gtk_widget_init_template (GTK_WIDGET (self));
   self->priv = totem_series_summary_get_instance_private (self);
+  self->priv->ready_videos = g_ptr_array_new_with_free_func (g_object_unref);
+  self->priv->ready_times = g_array_new (FALSE, FALSE, sizeof (gint64));
+  self->priv->operations = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->revalidations = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->subtitle_lookups = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->subtitles = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                                 (GDestroyNotify) g_hash_table_unref);
+  self->priv->subtitle_cancellable = g_cancellable_new ();
+  self->priv->cache_first = TRUE;
+  self->priv->monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                g_object_unref, (GDestroyNotify) monitor_free);
+  self->priv->pending_added = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                     g_object_unref, NULL);
+  self->priv->pending_removed = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                                       g_object_unref, NULL);
+  self->priv->watch_cancellable = g_cancellable_new ();
+  self->priv->ready_shows = g_ptr_array_new ();
+  self->priv->shows = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+                                             (GDestroyNotify) show_data_free);
+  self->priv->bulk_fetch = TRUE;
+  self->priv->scheduler = totem_scheduler_new (0);
+  self->priv->visible_season = -1;
+  self->priv->pending_season = -1;
+
+  g_signal_connect (self->priv->views, "notify::visible-child",
+                    G_CALLBACK (visible_show_changed_cb), self);
 }
 
 static void
@@ -547,8 +2854,29 @@ totem_series_summary_class_init (TotemSeriesSummaryClass *class)
   GObjectClass *object_class = G_OBJECT_CLASS (class);
   GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (class);
 
+  object_class->dispose = totem_series_summary_dispose;
   object_class->finalize = totem_series_summary_finalize;
+  widget_class->unmap = totem_series_summary_unmap;
+
+  /* Emitted with the video, the TotemSeriesSummaryStage it went through and
+   * how long it took, in microseconds */
+  signals[STAGE_FINISHED] =
+    g_signal_new ("stage-finished",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 3, GRL_TYPE_MEDIA, G_TYPE_INT, G_TYPE_INT64);
+
+  /* Emitted with the url of a video, the language of the subtitles the
+   * user picked for it and the path of the subtitle file */
+  signals[SUBTITLE_READY] =
+    g_signal_new ("subtitle-ready",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 3, G_TYPE_STRING, G_TYPE_STRING, G_TYPE_STRING);
 
   gtk_widget_class_set_template_from_resource (widget_class, "/org/totem/grilo/totem-series-summary.ui");
-  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesSummary, view);
+  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesSummary, views);
+  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesSummary, sidebar);
 }
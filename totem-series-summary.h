@@ -26,6 +26,8 @@
 #include <gtk/gtk.h>
 #include <grilo.h>
 
+#include "totem-hash-pool.h"
+
 G_BEGIN_DECLS
 
 #define TOTEM_TYPE_SERIES_SUMMARY             (totem_series_summary_get_type())
@@ -51,12 +53,64 @@ struct _TotemSeriesSummaryClass
   GtkBinClass parent_class;
 };
 
+/* Steps a video goes through, see the "stage-finished" signal */
+typedef enum
+{
+  TOTEM_SERIES_SUMMARY_STAGE_HASH,
+  TOTEM_SERIES_SUMMARY_STAGE_PARSE,
+  TOTEM_SERIES_SUMMARY_STAGE_RESOLVE,
+  TOTEM_SERIES_SUMMARY_STAGE_POSTER,
+  TOTEM_SERIES_SUMMARY_STAGE_VIEW,
+  TOTEM_SERIES_SUMMARY_N_STAGES
+} TotemSeriesSummaryStage;
+
+/* Time spent in a stage, in microseconds */
+typedef struct
+{
+  guint  count;
+  gint64 total;
+  gint64 max;
+} TotemSeriesSummaryStageStats;
+
 GType               totem_series_summary_get_type           (void) G_GNUC_CONST;
 
 /* External */
 TotemSeriesSummary *totem_series_summary_new (void);
 gboolean totem_series_summary_add_video (TotemSeriesSummary *self,
                                          GrlMedia           *video);
+guint totem_series_summary_add_videos (TotemSeriesSummary *self,
+                                       GPtrArray          *videos);
+void totem_series_summary_add_directory_async (TotemSeriesSummary  *self,
+                                               GFile               *directory,
+                                               GCancellable        *cancellable,
+                                               GAsyncReadyCallback  callback,
+                                               gpointer             user_data);
+gint totem_series_summary_add_directory_finish (TotemSeriesSummary  *self,
+                                                GAsyncResult        *res,
+                                                GError             **error);
+gboolean totem_series_summary_remove_video (TotemSeriesSummary *self,
+                                            GrlMedia           *video);
+void totem_series_summary_cancel (TotemSeriesSummary *self);
+void totem_series_summary_set_cache_first (TotemSeriesSummary *self,
+                                           gboolean            cache_first);
+void totem_series_summary_set_watch (TotemSeriesSummary *self,
+                                     gboolean            watch);
+void totem_series_summary_set_hash_threads (TotemSeriesSummary *self,
+                                            gint                n_threads);
+void totem_series_summary_get_hash_stats (TotemSeriesSummary *self,
+                                          TotemHashPoolStats *stats);
+void totem_series_summary_set_max_in_flight (TotemSeriesSummary *self,
+                                             const gchar        *source_id,
+                                             guint               max_in_flight);
+void totem_series_summary_prioritize_season (TotemSeriesSummary *self,
+                                             gint                season);
+void totem_series_summary_get_stage_stats (TotemSeriesSummary           *self,
+                                           TotemSeriesSummaryStage       stage,
+                                           TotemSeriesSummaryStageStats *stats);
+guint totem_series_summary_get_queue_depth (TotemSeriesSummary *self,
+                                            const gchar        *source_id);
+void totem_series_summary_set_bulk_fetch (TotemSeriesSummary *self,
+                                          gboolean            bulk_fetch);
 
 G_END_DECLS
 
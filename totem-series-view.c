@@ -25,27 +25,219 @@
 #include <net/grl-net.h>
 #include <string.h>
 
+#include "totem-episode-list.h"
 #include "totem-episode-view.h"
 
 typedef struct _TotemSeriesViewPrivate
 {
-  GPtrArray *videos;
+  /* Url -> TotemEpisode of the episodes shown, allocated in the arena */
+  TotemEpisodeArena *arena;
+  GHashTable *videos;
   GHashTable *seasons;
 
+  GtkImage *poster;
   GtkLabel *description_label;
   GtkLabel *cast_label;
   GtkLabel *director_label;
   GtkLabel *writers_label;
   GtkLabel *season_title;
   GtkStack *episodes;
+  GtkWidget *previous_season;
+  GtkWidget *next_season;
+
+  /* Series wide data, or else the one video it is shown from */
+  GrlMedia *show;
+  GrlMedia *header_video;
+  gint visible_season;
+
+  guint dirty;
+  guint update_id;
+
+  /* Rows of the seasons next to the visible one are created in idle time,
+   * the ones far away are dropped above the budget */
+  guint prefetch_id;
+  guint row_budget;
+
+  /* Url of the episode under the pointer, whose subtitles are looked up
+   * if it stays there */
+  gchar *hover_url;
+  guint  hover_id;
 } TotemSeriesViewPrivate;
 
+/* Labels to refresh on the next update */
+enum {
+  DIRTY_DESCRIPTION  = 1 << 0,
+  DIRTY_CAST         = 1 << 1,
+  DIRTY_DIRECTOR     = 1 << 2,
+  DIRTY_WRITERS      = 1 << 3,
+  DIRTY_SEASON_TITLE = 1 << 4,
+  DIRTY_NAVIGATION   = 1 << 5,
+  DIRTY_HEADER       = DIRTY_DESCRIPTION | DIRTY_CAST | DIRTY_DIRECTOR | DIRTY_WRITERS
+};
+
+#define PREFETCH_PRIORITY G_PRIORITY_LOW
+
+/* Sweeping the pointer over a long list should not look anything up */
+#define HOVER_DELAY_MS 400
+#define DEFAULT_ROW_BUDGET 200
+
+enum {
+  SEASON_CHANGED,
+  SUBTITLES_NEEDED,
+  SUBTITLE_SELECTED,
+  LAST_SIGNAL
+};
+
+static guint signals[LAST_SIGNAL] = { 0 };
+
+/* Episodes of a season are kept in a model, sorted by episode number; the
+ * rows are only created once the season is shown */
+typedef struct
+{
+  GtkListBox       *list_box;
+  TotemEpisodeList *episodes;
+  gboolean          bound;
+  gint              year;
+} SeasonData;
+
 G_DEFINE_TYPE_WITH_PRIVATE (TotemSeriesView, totem_series_view, GTK_TYPE_BIN);
 
 /* -------------------------------------------------------------------------- *
  * Internal / Helpers
  * -------------------------------------------------------------------------- */
 
+static void
+season_data_free (SeasonData *season)
+{
+  g_clear_object (&season->episodes);
+  g_slice_free (SeasonData, season);
+}
+
+/* Season of @episode and its position there, or NULL */
+static SeasonData *
+lookup_episode (TotemSeriesView    *self,
+                const TotemEpisode *episode,
+                gint               *position)
+{
+  SeasonData *season;
+
+  season = g_hash_table_lookup (self->priv->seasons, GINT_TO_POINTER (episode->season));
+  if (season == NULL)
+    return NULL;
+
+  *position = totem_episode_list_find (season->episodes, episode);
+  return (*position >= 0) ? season : NULL;
+}
+
+static void
+episode_subtitles_needed_cb (TotemEpisodeView *episode_view,
+                             TotemSeriesView  *self)
+{
+  g_signal_emit (self, signals[SUBTITLES_NEEDED], 0,
+                 totem_episode_view_get_episode (episode_view));
+}
+
+static void
+episode_subtitle_selected_cb (TotemEpisodeView *episode_view,
+                              const gchar      *language,
+                              TotemSeriesView  *self)
+{
+  g_signal_emit (self, signals[SUBTITLE_SELECTED], 0,
+                 totem_episode_view_get_episode (episode_view), language);
+}
+
+static GtkWidget *
+create_episode_row (gpointer item,
+                    gpointer user_data)
+{
+  TotemSeriesView *self = TOTEM_SERIES_VIEW (user_data);
+  TotemEpisodeView *episode_view;
+
+  episode_view = totem_episode_view_new ();
+  totem_episode_view_set_episode (episode_view,
+                                  totem_episode_item_get_episode (TOTEM_EPISODE_ITEM (item)));
+  g_signal_connect (episode_view, "subtitles-needed",
+                    G_CALLBACK (episode_subtitles_needed_cb), self);
+  g_signal_connect (episode_view, "subtitle-selected",
+                    G_CALLBACK (episode_subtitle_selected_cb), self);
+  gtk_widget_show (GTK_WIDGET (episode_view));
+
+  return GTK_WIDGET (episode_view);
+}
+
+/* The TotemEpisodeView of the row at @position */
+static TotemEpisodeView *
+get_episode_row (SeasonData *season,
+                 gint        position)
+{
+  GtkListBoxRow *row;
+
+  row = gtk_list_box_get_row_at_index (season->list_box, position);
+  return TOTEM_EPISODE_VIEW (gtk_bin_get_child (GTK_BIN (row)));
+}
+
+static void
+season_data_bind (TotemSeriesView *self,
+                  SeasonData      *season)
+{
+  if (season->bound)
+    return;
+
+  gtk_list_box_bind_model (season->list_box,
+                           G_LIST_MODEL (season->episodes),
+                           create_episode_row,
+                           self, NULL);
+  season->bound = TRUE;
+}
+
+/* The rows go away, the episodes stay in the model */
+static void
+season_data_unbind (SeasonData *season)
+{
+  if (!season->bound)
+    return;
+
+  gtk_list_box_bind_model (season->list_box, NULL, NULL, NULL, NULL);
+  season->bound = FALSE;
+}
+
+/* The closest season before (@direction < 0) or after @season */
+static gboolean
+get_adjacent_season (TotemSeriesView *self,
+                     gint             season,
+                     gint             direction,
+                     gint            *adjacent)
+{
+  GHashTableIter iter;
+  gpointer key;
+  gboolean found = FALSE;
+
+  g_hash_table_iter_init (&iter, self->priv->seasons);
+  while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    gint number = GPOINTER_TO_INT (key);
+
+    if ((number - season) * direction <= 0)
+      continue;
+
+    if (!found || ABS (number - season) < ABS (*adjacent - season)) {
+      *adjacent = number;
+      found = TRUE;
+    }
+  }
+  return found;
+}
+
+static void
+show_season (TotemSeriesView *self,
+             gint             season)
+{
+  gchar *name;
+
+  name = g_strdup_printf ("%d", season);
+  gtk_stack_set_visible_child_name (self->priv->episodes, name);
+  g_free (name);
+}
+
 /* For GrlKeys that have several values, return all of them in one
  * string separated by comma; */
 static gchar *
@@ -109,55 +301,385 @@ totem_series_view_set_writers (TotemSeriesView *self,
 static void
 totem_series_view_update (TotemSeriesView *self)
 {
-  const GPtrArray *videos;
-  GrlMedia *video;
-  const gchar *description;
-  const gchar *cast;
-  const gchar *director;
-  const gchar *writers;
-  gchar *season_title_string;
-  gint season_number;
-  gint season_year;
-
-  videos = self->priv->videos;
-
-  video = NULL;
-  if (videos != NULL && videos->len > 0)
-    video = g_ptr_array_index (videos, 0);
-
-  description = NULL;
-  if (video != NULL)
-    description = grl_media_get_description (video);
-  if (description == NULL)
-    description = "";
-  totem_series_view_set_description (self, description);
-
-  cast = NULL;
-  if (video != NULL)
-    cast = get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_PERFORMER);
-  if (cast == NULL)
-    cast = "";
-  totem_series_view_set_cast (self, cast);
-
-  director = NULL;
-  if (video != NULL)
-    director = get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_DIRECTOR);
-  if (director == NULL)
-    director = "";
-  totem_series_view_set_director (self, director);
-
-  writers = NULL;
-  if (video != NULL)
-    writers = get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_AUTHOR);
-  if (writers == NULL)
-    writers = "";
-  totem_series_view_set_writers (self, writers);
-
-  season_number = 0; // TODO
-  season_year = 0; // TODO
-  season_title_string = g_strdup_printf ("Season %d (%d)", season_number, season_year);
-  gtk_label_set_text (self->priv->season_title, season_title_string);
-  g_free (season_title_string);
+  TotemSeriesViewPrivate *priv = self->priv;
+  GrlMedia *video = priv->show ? priv->show : priv->header_video;
+  gchar *text;
+
+  if (priv->dirty & DIRTY_DESCRIPTION) {
+    const gchar *description = NULL;
+
+    if (video != NULL)
+      description = grl_media_get_description (video);
+    totem_series_view_set_description (self, description ? description : "");
+  }
+
+  if (priv->dirty & DIRTY_CAST) {
+    text = video ? get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_PERFORMER) : NULL;
+    totem_series_view_set_cast (self, text ? text : "");
+    g_free (text);
+  }
+
+  if (priv->dirty & DIRTY_DIRECTOR) {
+    text = video ? get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_DIRECTOR) : NULL;
+    totem_series_view_set_director (self, text ? text : "");
+    g_free (text);
+  }
+
+  if (priv->dirty & DIRTY_WRITERS) {
+    text = video ? get_data_from_media (GRL_DATA (video), GRL_METADATA_KEY_AUTHOR) : NULL;
+    totem_series_view_set_writers (self, text ? text : "");
+    g_free (text);
+  }
+
+  if (priv->dirty & DIRTY_SEASON_TITLE) {
+    SeasonData *season;
+
+    season = g_hash_table_lookup (priv->seasons, GINT_TO_POINTER (priv->visible_season));
+    if (g_hash_table_size (priv->seasons) == 0)
+      text = g_strdup ("");
+    else if (season != NULL && season->year > 0)
+      text = g_strdup_printf ("Season %d (%d)", priv->visible_season, season->year);
+    else
+      text = g_strdup_printf ("Season %d", priv->visible_season);
+    gtk_label_set_text (priv->season_title, text);
+    g_free (text);
+  }
+
+  if (priv->dirty & DIRTY_NAVIGATION) {
+    gint adjacent;
+
+    gtk_widget_set_sensitive (priv->previous_season,
+                              get_adjacent_season (self, priv->visible_season, -1, &adjacent));
+    gtk_widget_set_sensitive (priv->next_season,
+                              get_adjacent_season (self, priv->visible_season, 1, &adjacent));
+  }
+
+  priv->dirty = 0;
+}
+
+static gboolean
+totem_series_view_update_tick (GtkWidget     *widget,
+                               GdkFrameClock *frame_clock,
+                               gpointer       user_data)
+{
+  TotemSeriesView *self = TOTEM_SERIES_VIEW (widget);
+
+  self->priv->update_id = 0;
+  totem_series_view_update (self);
+  return G_SOURCE_REMOVE;
+}
+
+/* Labels are refreshed from the frame clock, once per frame before the
+ * layout; a view that is not realized yet waits until it is */
+static void
+totem_series_view_queue_update (TotemSeriesView *self,
+                                guint            dirty)
+{
+  self->priv->dirty |= dirty;
+  if (self->priv->update_id != 0 || self->priv->dirty == 0)
+    return;
+
+  self->priv->update_id = gtk_widget_add_tick_callback (GTK_WIDGET (self),
+                                                        totem_series_view_update_tick,
+                                                        NULL,
+                                                        NULL);
+}
+
+/* Bind the seasons next to the visible one so that switching to them is
+ * instant, then unbind the farthest ones while above the row budget */
+static gboolean
+prefetch_seasons_idle (gpointer user_data)
+{
+  TotemSeriesView *self = user_data;
+  TotemSeriesViewPrivate *priv = self->priv;
+  GHashTableIter iter;
+  SeasonData *season;
+  gpointer key;
+  guint rows;
+  gint adjacent, previous, next;
+
+  priv->prefetch_id = 0;
+  previous = next = priv->visible_season;
+
+  if (get_adjacent_season (self, priv->visible_season, -1, &adjacent)) {
+    previous = adjacent;
+    season_data_bind (self, g_hash_table_lookup (priv->seasons, GINT_TO_POINTER (adjacent)));
+  }
+  if (get_adjacent_season (self, priv->visible_season, 1, &adjacent)) {
+    next = adjacent;
+    season_data_bind (self, g_hash_table_lookup (priv->seasons, GINT_TO_POINTER (adjacent)));
+  }
+
+  rows = 0;
+  g_hash_table_iter_init (&iter, priv->seasons);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &season)) {
+    if (season->bound)
+      rows += g_list_model_get_n_items (G_LIST_MODEL (season->episodes));
+  }
+
+  while (rows > priv->row_budget) {
+    SeasonData *farthest = NULL;
+    gint distance = 0;
+
+    g_hash_table_iter_init (&iter, priv->seasons);
+    while (g_hash_table_iter_next (&iter, &key, (gpointer *) &season)) {
+      gint number = GPOINTER_TO_INT (key);
+
+      if (!season->bound || (number >= previous && number <= next))
+        continue;
+
+      if (ABS (number - priv->visible_season) > distance) {
+        distance = ABS (number - priv->visible_season);
+        farthest = season;
+      }
+    }
+
+    if (farthest == NULL)
+      break;
+
+    rows -= g_list_model_get_n_items (G_LIST_MODEL (farthest->episodes));
+    season_data_unbind (farthest);
+  }
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+totem_series_view_queue_prefetch (TotemSeriesView *self)
+{
+  if (self->priv->prefetch_id != 0 || self->priv->visible_season < 0)
+    return;
+
+  self->priv->prefetch_id = g_idle_add_full (PREFETCH_PRIORITY,
+                                             prefetch_seasons_idle,
+                                             self,
+                                             NULL);
+}
+
+static void
+row_activated_cb (GtkListBox    *list_box,
+                  GtkListBoxRow *row,
+                  gpointer       user_data)
+{
+  TotemEpisodeView *episode_view;
+
+  episode_view = TOTEM_EPISODE_VIEW (gtk_bin_get_child (GTK_BIN (row)));
+  totem_episode_view_set_expanded (episode_view,
+                                   !totem_episode_view_get_expanded (episode_view));
+}
+
+static void
+cancel_hover (TotemSeriesView *self)
+{
+  TotemSeriesViewPrivate *priv = self->priv;
+
+  if (priv->hover_id != 0) {
+    g_source_remove (priv->hover_id);
+    priv->hover_id = 0;
+  }
+  g_clear_pointer (&priv->hover_url, g_free);
+}
+
+/* The row might be gone meanwhile, it is looked up again */
+static gboolean
+hover_timeout (gpointer user_data)
+{
+  TotemSeriesView *self = user_data;
+  TotemSeriesViewPrivate *priv = self->priv;
+  const TotemEpisode *episode;
+  SeasonData *season = NULL;
+  gint position;
+
+  priv->hover_id = 0;
+  episode = g_hash_table_lookup (priv->videos, priv->hover_url);
+  if (episode != NULL)
+    season = lookup_episode (self, episode, &position);
+  if (season != NULL && season->bound)
+    totem_episode_view_request_subtitles (get_episode_row (season, position));
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Hovering an episode for a while is usually followed by expanding it */
+static gboolean
+list_box_motion_cb (GtkWidget       *list_box,
+                    GdkEventMotion  *event,
+                    TotemSeriesView *self)
+{
+  const TotemEpisode *episode;
+  GtkListBoxRow *row;
+
+  row = gtk_list_box_get_row_at_y (GTK_LIST_BOX (list_box), (gint) event->y);
+  if (row == NULL) {
+    cancel_hover (self);
+    return GDK_EVENT_PROPAGATE;
+  }
+
+  episode = totem_episode_view_get_episode (TOTEM_EPISODE_VIEW (gtk_bin_get_child (GTK_BIN (row))));
+  if (episode == NULL || g_strcmp0 (episode->url, self->priv->hover_url) == 0)
+    return GDK_EVENT_PROPAGATE;
+
+  cancel_hover (self);
+  self->priv->hover_url = g_strdup (episode->url);
+  self->priv->hover_id = g_timeout_add (HOVER_DELAY_MS, hover_timeout, self);
+
+  return GDK_EVENT_PROPAGATE;
+}
+
+static gboolean
+list_box_leave_cb (GtkWidget        *list_box,
+                   GdkEventCrossing *event,
+                   TotemSeriesView  *self)
+{
+  cancel_hover (self);
+  return GDK_EVENT_PROPAGATE;
+}
+
+static void
+on_previous_season_clicked (GtkButton       *button,
+                            TotemSeriesView *self)
+{
+  gint season;
+
+  if (get_adjacent_season (self, self->priv->visible_season, -1, &season))
+    show_season (self, season);
+}
+
+static void
+on_next_season_clicked (GtkButton       *button,
+                        TotemSeriesView *self)
+{
+  gint season;
+
+  if (get_adjacent_season (self, self->priv->visible_season, 1, &season))
+    show_season (self, season);
+}
+
+static void
+visible_season_changed_cb (GObject         *stack,
+                           GParamSpec      *pspec,
+                           TotemSeriesView *self)
+{
+  const gchar *name;
+  SeasonData *season;
+  gintptr season_number;
+
+  name = gtk_stack_get_visible_child_name (GTK_STACK (stack));
+  if (name == NULL)
+    return;
+
+  season_number = g_ascii_strtoll (name, NULL, 10);
+  season = g_hash_table_lookup (self->priv->seasons, (gpointer) season_number);
+  if (season != NULL)
+    season_data_bind (self, season);
+
+  /* The visible season is materialized first, its neighbors after */
+  self->priv->visible_season = season_number;
+  totem_series_view_queue_update (self, DIRTY_SEASON_TITLE | DIRTY_NAVIGATION);
+  totem_series_view_queue_prefetch (self);
+
+  g_signal_emit (self, signals[SEASON_CHANGED], 0, (gint) season_number);
+}
+
+static gboolean
+totem_series_view_insert_video (TotemSeriesView *self,
+                                GrlMedia        *video)
+{
+  TotemSeriesViewPrivate *priv = self->priv;
+  gintptr season_number;
+  gchar *season_number_string;
+  SeasonData *season;
+  const TotemEpisode *episode;
+
+  if (grl_media_get_url (video) == NULL ||
+      g_hash_table_contains (priv->videos, grl_media_get_url (video)))
+    return FALSE;
+
+  /* Nothing else of @video is kept, but for the series data */
+  episode = totem_episode_arena_add (priv->arena, video);
+  season_number = (gintptr) episode->season;
+  season = g_hash_table_lookup (self->priv->seasons, (gpointer) season_number);
+  if (season == NULL) {
+    season = g_slice_new0 (SeasonData);
+    season->episodes = totem_episode_list_new ();
+    season->list_box = GTK_LIST_BOX (gtk_list_box_new ());
+    gtk_widget_add_events (GTK_WIDGET (season->list_box),
+                           GDK_POINTER_MOTION_MASK | GDK_LEAVE_NOTIFY_MASK);
+    g_signal_connect (season->list_box, "row-activated",
+                      G_CALLBACK (row_activated_cb), NULL);
+    g_signal_connect (season->list_box, "motion-notify-event",
+                      G_CALLBACK (list_box_motion_cb), self);
+    g_signal_connect (season->list_box, "leave-notify-event",
+                      G_CALLBACK (list_box_leave_cb), self);
+    gtk_widget_show (GTK_WIDGET (season->list_box));
+    g_hash_table_insert (self->priv->seasons, (gpointer) season_number, season);
+
+    /* The first season added becomes visible and gets bound right away */
+    season_number_string = g_strdup_printf ("%ld", season_number);
+    gtk_stack_add_named (self->priv->episodes, GTK_WIDGET (season->list_box), season_number_string);
+    g_free (season_number_string);
+
+    /* It might be next to the visible one */
+    totem_series_view_queue_update (self, DIRTY_NAVIGATION);
+    totem_series_view_queue_prefetch (self);
+  }
+
+  /* A bound season gets the row right away, at the episode's position */
+  totem_episode_list_insert (season->episodes, episode);
+
+  g_hash_table_insert (priv->videos, (gpointer) episode->url, (gpointer) episode);
+
+  /* Series data comes from the first video that has it */
+  if (priv->header_video == NULL ||
+      (grl_media_get_description (priv->header_video) == NULL &&
+       grl_media_get_description (video) != NULL)) {
+    g_clear_object (&priv->header_video);
+    priv->header_video = g_object_ref (video);
+    totem_series_view_queue_update (self, DIRTY_HEADER);
+  }
+
+  if (episode->year > 0 && (season->year == 0 || episode->year < season->year)) {
+    season->year = episode->year;
+    if (season_number == priv->visible_season)
+      totem_series_view_queue_update (self, DIRTY_SEASON_TITLE);
+  }
+
+  return TRUE;
+}
+
+static gboolean
+totem_series_view_take_out_video (TotemSeriesView *self,
+                                  const gchar     *url)
+{
+  TotemSeriesViewPrivate *priv = self->priv;
+  const TotemEpisode *episode;
+  SeasonData *season;
+  gintptr season_number;
+
+  episode = g_hash_table_lookup (priv->videos, url);
+  if (episode == NULL)
+    return FALSE;
+
+  season_number = (gintptr) episode->season;
+  season = g_hash_table_lookup (priv->seasons, (gpointer) season_number);
+  totem_episode_list_remove (season->episodes, episode);
+
+  if (g_list_model_get_n_items (G_LIST_MODEL (season->episodes)) == 0) {
+    /* Another season becomes visible, if any */
+    gtk_container_remove (GTK_CONTAINER (priv->episodes), GTK_WIDGET (season->list_box));
+    g_hash_table_remove (priv->seasons, (gpointer) season_number);
+    totem_series_view_queue_update (self, DIRTY_SEASON_TITLE | DIRTY_NAVIGATION);
+  }
+
+  g_hash_table_remove (priv->videos, url);
+  totem_episode_arena_release (priv->arena, episode);
+
+  /* Otherwise the series data stays, it is the same for every episode */
+  if (g_hash_table_size (priv->videos) == 0) {
+    g_clear_object (&priv->header_video);
+    totem_series_view_queue_update (self, DIRTY_HEADER);
+  }
+  return TRUE;
 }
 
 /* -------------------------------------------------------------------------- *
@@ -178,41 +700,229 @@ gboolean
 totem_series_view_add_video (TotemSeriesView *self,
                              GrlMedia        *video)
 {
-  gintptr season_number;
-  gchar *season_number_string;
-  GtkWidget *season_view;
-  TotemEpisodeView *episode_view;
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
 
-  // TODO If the series isn't the same, don't add the new video
+  return totem_series_view_insert_video (self, video);
+}
 
-  season_number = (gintptr) grl_media_get_season (video);
-  if (g_hash_table_contains (self->priv->seasons, (gpointer) season_number))
-    season_view = g_hash_table_lookup (self->priv->seasons, (gpointer) season_number);
-  else {
-    season_view = gtk_list_box_new ();
-    gtk_widget_show (season_view);
-    g_hash_table_insert (self->priv->seasons, (gpointer) season_number, season_view);
+/* Add all @videos at once; only the labels that changed are refreshed,
+ * once, on the next frame */
+gboolean
+totem_series_view_add_videos (TotemSeriesView *self,
+                              GPtrArray       *videos)
+{
+  guint i;
 
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), FALSE);
+  g_return_val_if_fail (videos != NULL, FALSE);
 
-    season_number_string = g_strdup_printf ("%ld", season_number);
-    gtk_stack_add_named (self->priv->episodes, season_view, season_number_string);
-    g_free (season_number_string);
-  }
+  if (videos->len == 0)
+    return TRUE;
 
-  // TODO if the episode is already contained, do not add it (?)
+  for (i = 0; i < videos->len; i++)
+    totem_series_view_insert_video (self, g_ptr_array_index (videos, i));
 
-  episode_view = totem_episode_view_new ();
-  totem_episode_view_set_media (episode_view, video);
-  gtk_widget_show (GTK_WIDGET (episode_view));
-  gtk_container_add (GTK_CONTAINER (season_view), GTK_WIDGET (episode_view));
+  return TRUE;
+}
+
+/* Series wide data, such as description, cast or writers, shared by
+ * every episode. Otherwise it is taken from one of the episodes. */
+void
+totem_series_view_set_show (TotemSeriesView *self,
+                            GrlMedia        *show)
+{
+  TotemSeriesViewPrivate *priv;
 
-  g_ptr_array_add (self->priv->videos, video);
+  g_return_if_fail (TOTEM_IS_SERIES_VIEW (self));
+  g_return_if_fail (show == NULL || GRL_IS_MEDIA (show));
 
-  totem_series_view_update (self);
+  priv = self->priv;
+  if (show != NULL)
+    g_object_ref (show);
+  g_clear_object (&priv->show);
+  priv->show = show;
+
+  totem_series_view_queue_update (self, DIRTY_HEADER);
+}
+
+/* Remove the episode with the url of @video, e.g. once its file is
+ * deleted. Its season goes away with its last episode. */
+gboolean
+totem_series_view_remove_video (TotemSeriesView *self,
+                                GrlMedia        *video)
+{
+  const gchar *url;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  url = grl_media_get_url (video);
+  if (url == NULL)
+    return FALSE;
+
+  return totem_series_view_take_out_video (self, url);
+}
+
+/* Refresh the row of the episode with the url of @video, once its
+ * metadata changed. The season and episode numbers must not change. */
+gboolean
+totem_series_view_update_video (TotemSeriesView *self,
+                                GrlMedia        *video)
+{
+  TotemSeriesViewPrivate *priv;
+  const TotemEpisode *shown, *episode;
+  SeasonData *season;
+  gint position;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), FALSE);
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  priv = self->priv;
+  if (grl_media_get_url (video) == NULL)
+    return FALSE;
+
+  shown = g_hash_table_lookup (priv->videos, grl_media_get_url (video));
+  if (shown == NULL)
+    return FALSE;
+
+  season = g_hash_table_lookup (priv->seasons, GINT_TO_POINTER (shown->season));
+
+  /* Records are immutable, the row shows the new one in place */
+  episode = totem_episode_arena_add (priv->arena, video);
+  position = (episode->season == shown->season) ?
+    totem_episode_list_replace (season->episodes, shown, episode) : -1;
+  if (position < 0) {
+    totem_episode_arena_release (priv->arena, episode);
+    return FALSE;
+  }
 
+  g_hash_table_insert (priv->videos, (gpointer) episode->url, (gpointer) episode);
+  if (season->bound)
+    totem_episode_view_set_episode (get_episode_row (season, position), episode);
+  totem_episode_arena_release (priv->arena, shown);
+
+  if (priv->header_video != NULL &&
+      g_strcmp0 (grl_media_get_url (priv->header_video), episode->url) == 0) {
+    g_object_unref (priv->header_video);
+    priv->header_video = g_object_ref (video);
+    totem_series_view_queue_update (self, DIRTY_HEADER);
+  }
   return TRUE;
 }
 
+/* Rows kept for the seasons other than the visible one and its neighbors;
+ * the farthest seasons drop their rows first */
+void
+totem_series_view_set_row_budget (TotemSeriesView *self,
+                                  guint            row_budget)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_VIEW (self));
+
+  self->priv->row_budget = row_budget;
+  totem_series_view_queue_prefetch (self);
+}
+
+/* TotemEpisode of the videos shown, in no particular order. Free the list
+ * with g_list_free(). */
+GList *
+totem_series_view_get_episodes (TotemSeriesView *self)
+{
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), NULL);
+
+  return g_hash_table_get_values (self->priv->videos);
+}
+
+/* Languages of the subtitles of the episode of @url, shown once its row
+ * asked for them with ::subtitles-needed */
+void
+totem_series_view_set_subtitles (TotemSeriesView     *self,
+                                 const gchar         *url,
+                                 const gchar * const *languages)
+{
+  const TotemEpisode *episode;
+  SeasonData *season;
+  gint position;
+
+  g_return_if_fail (TOTEM_IS_SERIES_VIEW (self));
+  g_return_if_fail (url != NULL);
+
+  episode = g_hash_table_lookup (self->priv->videos, url);
+  if (episode == NULL)
+    return;
+
+  /* Rows dropped meanwhile ask again once created */
+  season = lookup_episode (self, episode, &position);
+  if (season == NULL || !season->bound)
+    return;
+
+  totem_episode_view_set_subtitles (get_episode_row (season, position), languages);
+}
+
+/* @poster is expected to be scaled already, see POSTER_WIDTH and
+ * POSTER_HEIGHT in TotemSeriesSummary */
+void
+totem_series_view_set_poster (TotemSeriesView *self,
+                              GdkPixbuf       *poster)
+{
+  g_return_if_fail (TOTEM_IS_SERIES_VIEW (self));
+
+  if (poster != NULL)
+    gtk_image_set_from_pixbuf (self->priv->poster, poster);
+  else
+    gtk_image_set_from_icon_name (self->priv->poster, "image-missing", GTK_ICON_SIZE_DIALOG);
+}
+
+/* The episode after @episode in its season, or NULL */
+const TotemEpisode *
+totem_series_view_get_next_episode (TotemSeriesView    *self,
+                                    const TotemEpisode *episode)
+{
+  const TotemEpisode *next;
+  SeasonData *season;
+  gint position;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), NULL);
+  g_return_val_if_fail (episode != NULL, NULL);
+
+  season = lookup_episode (self, episode, &position);
+  if (season == NULL)
+    return NULL;
+
+  /* Other files of the same episode are skipped */
+  do {
+    next = totem_episode_list_get_episode (season->episodes, ++position);
+  } while (next != NULL && next->episode == episode->episode);
+
+  return next;
+}
+
+/* The episode before @episode in its season, or NULL */
+const TotemEpisode *
+totem_series_view_get_previous_episode (TotemSeriesView    *self,
+                                        const TotemEpisode *episode)
+{
+  const TotemEpisode *previous;
+  SeasonData *season;
+  gint position;
+
+  g_return_val_if_fail (TOTEM_IS_SERIES_VIEW (self), NULL);
+  g_return_val_if_fail (episode != NULL, NULL);
+
+  season = lookup_episode (self, episode, &position);
+  if (season == NULL)
+    return NULL;
+
+  /* Other files of the same episode are skipped */
+  do {
+    if (position == 0)
+      return NULL;
+    previous = totem_episode_list_get_episode (season->episodes, --position);
+  } while (previous->episode == episode->episode);
+
+  return previous;
+}
+
 /* -------------------------------------------------------------------------- *
  * Object
  * -------------------------------------------------------------------------- */
@@ -222,10 +932,25 @@ totem_series_view_finalize (GObject *object)
 {
   TotemSeriesViewPrivate *priv = TOTEM_SERIES_VIEW (object)->priv;
 
+  if (priv->update_id != 0) {
+    gtk_widget_remove_tick_callback (GTK_WIDGET (object), priv->update_id);
+    priv->update_id = 0;
+  }
+  if (priv->prefetch_id != 0) {
+    g_source_remove (priv->prefetch_id);
+    priv->prefetch_id = 0;
+  }
+  cancel_hover (TOTEM_SERIES_VIEW (object));
+
+  g_clear_pointer (&priv->videos, g_hash_table_unref);
+  g_clear_object (&priv->show);
+  g_clear_object (&priv->header_video);
+
   if (priv->seasons != NULL) {
     g_hash_table_unref (priv->seasons);
     priv->seasons = NULL;
   }
+  g_clear_pointer (&priv->arena, totem_episode_arena_free);
 
   G_OBJECT_CLASS (totem_series_view_parent_class)->finalize (object);
 }
@@ -236,8 +961,15 @@ totem_series_view_init (TotemSeriesView *self)
   gtk_widget_init_template (GTK_WIDGET (self));
   self->priv = totem_series_view_get_instance_private (self);
 
-  self->priv->videos = g_ptr_array_new_with_free_func (g_object_unref);
-  self->priv->seasons = g_hash_table_new (g_direct_hash, g_direct_equal);
+  self->priv->arena = totem_episode_arena_new ();
+  self->priv->videos = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->visible_season = -1;
+  self->priv->row_budget = DEFAULT_ROW_BUDGET;
+  self->priv->seasons = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                               (GDestroyNotify) season_data_free);
+
+  g_signal_connect (self->priv->episodes, "notify::visible-child-name",
+                    G_CALLBACK (visible_season_changed_cb), self);
 }
 
 static void
@@ -248,11 +980,42 @@ totem_series_view_class_init (TotemSeriesViewClass *class)
 
   object_class->finalize = totem_series_view_finalize;
 
+  /* Emitted with the season number when the visible season changes */
+  signals[SEASON_CHANGED] =
+    g_signal_new ("season-changed",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_INT);
+
+  /* Emitted with the TotemEpisode of a row that wants its subtitles, see
+   * totem_series_view_set_subtitles() */
+  signals[SUBTITLES_NEEDED] =
+    g_signal_new ("subtitles-needed",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  /* Emitted with the TotemEpisode and the language of the subtitles the
+   * user picked */
+  signals[SUBTITLE_SELECTED] =
+    g_signal_new ("subtitle-selected",
+                  G_TYPE_FROM_CLASS (class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL, NULL,
+                  G_TYPE_NONE, 2, G_TYPE_POINTER, G_TYPE_STRING);
+
   gtk_widget_class_set_template_from_resource (widget_class, "/org/totem/grilo/totem-series-view.ui");
+  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, poster);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, description_label);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, cast_label);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, director_label);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, writers_label);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, season_title);
   gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, episodes);
+  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, previous_season);
+  gtk_widget_class_bind_template_child_private (widget_class, TotemSeriesView, next_season);
+  gtk_widget_class_bind_template_callback (widget_class, on_previous_season_clicked);
+  gtk_widget_class_bind_template_callback (widget_class, on_next_season_clicked);
 }
@@ -27,6 +27,8 @@
 #include <grilo.h>
 #include <gtk/gtk.h>
 
+#include "totem-episode.h"
+
 G_BEGIN_DECLS
 
 #define TOTEM_TYPE_SERIES_VIEW             (totem_series_view_get_type())
@@ -58,6 +60,26 @@ GType               totem_series_view_get_type           (void) G_GNUC_CONST;
 TotemSeriesView *totem_series_view_new (void);
 gboolean totem_series_view_add_video (TotemSeriesView *self,
                                       GrlMedia        *video);
+gboolean totem_series_view_add_videos (TotemSeriesView *self,
+                                       GPtrArray       *videos);
+void totem_series_view_set_show (TotemSeriesView *self,
+                                 GrlMedia        *show);
+gboolean totem_series_view_remove_video (TotemSeriesView *self,
+                                         GrlMedia        *video);
+gboolean totem_series_view_update_video (TotemSeriesView *self,
+                                         GrlMedia        *video);
+void totem_series_view_set_row_budget (TotemSeriesView *self,
+                                       guint            row_budget);
+GList *totem_series_view_get_episodes (TotemSeriesView *self);
+void totem_series_view_set_subtitles (TotemSeriesView     *self,
+                                      const gchar         *url,
+                                      const gchar * const *languages);
+void totem_series_view_set_poster (TotemSeriesView *self,
+                                   GdkPixbuf       *poster);
+const TotemEpisode *totem_series_view_get_next_episode (TotemSeriesView    *self,
+                                                        const TotemEpisode *episode);
+const TotemEpisode *totem_series_view_get_previous_episode (TotemSeriesView    *self,
+                                                            const TotemEpisode *episode);
 
 G_END_DECLS
 
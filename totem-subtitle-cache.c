@@ -0,0 +1,364 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#include "totem-subtitle-cache.h"
+
+#include <net/grl-net.h>
+#include <string.h>
+
+#include "totem-trace.h"
+
+/* Subtitle files are small, nothing is ever evicted */
+typedef struct _TotemSubtitleCachePrivate
+{
+  gchar *directory;
+
+  /* File name -> FetchData of its running download */
+  GHashTable *in_flight;
+  GrlNetWc   *wc;
+} TotemSubtitleCachePrivate;
+
+G_DEFINE_TYPE_WITH_PRIVATE (TotemSubtitleCache, totem_subtitle_cache, G_TYPE_OBJECT);
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+/* Subtitles are identified by the gibest hash of their video and their
+ * language; the same file elsewhere finds them again */
+static gchar *
+get_name (const gchar *hash,
+          const gchar *language)
+{
+  gchar *name;
+
+  name = g_strdup_printf ("%s-%s.srt", hash, language);
+  return g_strcanon (name, G_CSET_A_2_Z G_CSET_a_2_z G_CSET_DIGITS "-_.", '_');
+}
+
+static gchar *
+get_path (TotemSubtitleCache *self,
+          const gchar        *name)
+{
+  return g_build_filename (self->priv->directory, name, NULL);
+}
+
+/* Subtitles are usually served gzipped */
+static GBytes *
+maybe_decompress (const gchar  *data,
+                  gsize         len,
+                  GError      **error)
+{
+  GZlibDecompressor *decompressor;
+  GInputStream *compressed, *stream;
+  GOutputStream *out;
+  GBytes *bytes;
+
+  if (len < 2 || (guchar) data[0] != 0x1f || (guchar) data[1] != 0x8b)
+    return g_bytes_new (data, len);
+
+  compressed = g_memory_input_stream_new_from_data (data, len, NULL);
+  decompressor = g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+  stream = g_converter_input_stream_new (compressed, G_CONVERTER (decompressor));
+  out = g_memory_output_stream_new_resizable ();
+
+  bytes = NULL;
+  if (g_output_stream_splice (out, stream, G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET, NULL, error) >= 0)
+    bytes = g_memory_output_stream_steal_as_bytes (G_MEMORY_OUTPUT_STREAM (out));
+
+  g_object_unref (out);
+  g_object_unref (stream);
+  g_object_unref (decompressor);
+  g_object_unref (compressed);
+
+  return bytes;
+}
+
+/* One download shared by every request of the same subtitles; it is
+ * cancelled once all of them are */
+typedef struct
+{
+  TotemSubtitleCache *cache;
+  gchar              *name;
+  GCancellable       *cancellable;
+  GList              *waiters;
+  gint64              start;
+} FetchData;
+
+typedef struct
+{
+  FetchData *fd;
+  GTask     *task;
+  gulong     cancelled_id;
+} FetchWaiter;
+
+static void
+fetch_waiter_free (FetchWaiter *w)
+{
+  GCancellable *cancellable = g_task_get_cancellable (w->task);
+
+  if (w->cancelled_id != 0)
+    g_signal_handler_disconnect (cancellable, w->cancelled_id);
+  g_object_unref (w->task);
+  g_slice_free (FetchWaiter, w);
+}
+
+static void
+fetch_waiter_cancelled_cb (GCancellable *cancellable,
+                           FetchWaiter  *w)
+{
+  FetchData *fd = w->fd;
+
+  fd->waiters = g_list_remove (fd->waiters, w);
+  g_task_return_error_if_cancelled (w->task);
+  fetch_waiter_free (w);
+
+  if (fd->waiters != NULL)
+    return;
+
+  /* Nobody wants these subtitles anymore, a new request starts over */
+  g_hash_table_remove (fd->cache->priv->in_flight, fd->name);
+  g_cancellable_cancel (fd->cancellable);
+}
+
+static void
+fetch_add_waiter (FetchData *fd,
+                  GTask     *task)
+{
+  GCancellable *cancellable = g_task_get_cancellable (task);
+  FetchWaiter *w;
+
+  w = g_slice_new0 (FetchWaiter);
+  w->fd = fd;
+  w->task = task;
+  if (cancellable != NULL)
+    w->cancelled_id = g_signal_connect (cancellable, "cancelled",
+                                        G_CALLBACK (fetch_waiter_cancelled_cb), w);
+  fd->waiters = g_list_prepend (fd->waiters, w);
+}
+
+static void
+fetch_done (GObject      *source_object,
+            GAsyncResult *res,
+            gpointer      user_data)
+{
+  FetchData *fd = user_data;
+  TotemSubtitleCache *self = fd->cache;
+  gchar *data, *path;
+  GBytes *bytes;
+  GList *waiters, *it;
+  GError *err = NULL;
+  gsize len;
+
+  if (g_hash_table_lookup (self->priv->in_flight, fd->name) == fd)
+    g_hash_table_remove (self->priv->in_flight, fd->name);
+  totem_trace_span ("subtitle-download", fd->start, g_get_monotonic_time (), fd->name);
+
+  path = NULL;
+  if (grl_net_wc_request_finish (GRL_NET_WC (source_object), res, &data, &len, &err)) {
+    bytes = maybe_decompress (data, len, &err);
+    if (bytes != NULL) {
+      /* g_file_set_contents() writes to a temporary file and renames it */
+      path = get_path (self, fd->name);
+      if (!g_file_set_contents (path,
+                                g_bytes_get_data (bytes, NULL),
+                                g_bytes_get_size (bytes),
+                                &err))
+        g_clear_pointer (&path, g_free);
+      g_bytes_unref (bytes);
+    }
+  }
+
+  waiters = g_list_reverse (fd->waiters);
+  fd->waiters = NULL;
+  for (it = waiters; it != NULL; it = it->next) {
+    FetchWaiter *w = it->data;
+
+    if (path != NULL)
+      g_task_return_pointer (w->task, g_strdup (path), g_free);
+    else
+      g_task_return_error (w->task, g_error_copy (err));
+    fetch_waiter_free (w);
+  }
+
+  g_list_free (waiters);
+  g_clear_error (&err);
+  g_free (path);
+  g_free (fd->name);
+  g_object_unref (fd->cancellable);
+  g_object_unref (fd->cache);
+  g_slice_free (FetchData, fd);
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* @directory defaults to a folder in the user's cache directory */
+TotemSubtitleCache *
+totem_subtitle_cache_new (const gchar *directory)
+{
+  TotemSubtitleCache *self;
+  TotemSubtitleCachePrivate *priv;
+
+  self = g_object_new (TOTEM_TYPE_SUBTITLE_CACHE, NULL);
+  priv = self->priv;
+
+  if (directory != NULL)
+    priv->directory = g_strdup (directory);
+  else
+    priv->directory = g_build_filename (g_get_user_cache_dir (),
+                                        "totem-series",
+                                        "subtitles",
+                                        NULL);
+
+  if (g_mkdir_with_parents (priv->directory, 0700) != 0)
+    g_warning ("Failed to create subtitle cache at %s", priv->directory);
+
+  return self;
+}
+
+/* Returns the path of the subtitles in @language of the video with @hash,
+ * or NULL if they are not cached */
+gchar *
+totem_subtitle_cache_lookup (TotemSubtitleCache *self,
+                             const gchar        *hash,
+                             const gchar        *language)
+{
+  gchar *name, *path;
+
+  g_return_val_if_fail (TOTEM_IS_SUBTITLE_CACHE (self), NULL);
+  g_return_val_if_fail (hash != NULL, NULL);
+  g_return_val_if_fail (language != NULL, NULL);
+
+  name = get_name (hash, language);
+  path = get_path (self, name);
+  g_free (name);
+
+  if (!g_file_test (path, G_FILE_TEST_IS_REGULAR)) {
+    g_free (path);
+    return NULL;
+  }
+  return path;
+}
+
+/* Download the subtitles at @url into the cache, unless they are there
+ * already. Concurrent requests of the same subtitles share the download,
+ * which is cancelled once every one of them is. */
+void
+totem_subtitle_cache_fetch_async (TotemSubtitleCache  *self,
+                                  const gchar         *hash,
+                                  const gchar         *language,
+                                  const gchar         *url,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+  TotemSubtitleCachePrivate *priv;
+  FetchData *fd;
+  GTask *task;
+  gchar *name, *path;
+
+  g_return_if_fail (TOTEM_IS_SUBTITLE_CACHE (self));
+  g_return_if_fail (hash != NULL);
+  g_return_if_fail (language != NULL);
+  g_return_if_fail (url != NULL);
+
+  priv = self->priv;
+  task = g_task_new (self, cancellable, callback, user_data);
+  if (g_task_return_error_if_cancelled (task)) {
+    g_object_unref (task);
+    return;
+  }
+
+  path = totem_subtitle_cache_lookup (self, hash, language);
+  if (path != NULL) {
+    g_task_return_pointer (task, path, g_free);
+    g_object_unref (task);
+    return;
+  }
+
+  name = get_name (hash, language);
+  fd = g_hash_table_lookup (priv->in_flight, name);
+  if (fd != NULL) {
+    fetch_add_waiter (fd, task);
+    g_free (name);
+    return;
+  }
+
+  fd = g_slice_new0 (FetchData);
+  fd->cache = g_object_ref (self);
+  fd->name = name;
+  fd->cancellable = g_cancellable_new ();
+  fd->start = g_get_monotonic_time ();
+  fetch_add_waiter (fd, task);
+  g_hash_table_insert (priv->in_flight, fd->name, fd);
+
+  grl_net_wc_request_async (priv->wc, url, fd->cancellable, fetch_done, fd);
+}
+
+/* Returns the path of the subtitles */
+gchar *
+totem_subtitle_cache_fetch_finish (TotemSubtitleCache  *self,
+                                   GAsyncResult        *res,
+                                   GError             **error)
+{
+  g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+
+  return g_task_propagate_pointer (G_TASK (res), error);
+}
+
+/* -------------------------------------------------------------------------- *
+ * Object
+ * -------------------------------------------------------------------------- */
+
+static void
+totem_subtitle_cache_finalize (GObject *object)
+{
+  TotemSubtitleCachePrivate *priv = TOTEM_SUBTITLE_CACHE (object)->priv;
+
+  /* Downloads hold a reference on the cache */
+  g_warn_if_fail (g_hash_table_size (priv->in_flight) == 0);
+  g_clear_pointer (&priv->in_flight, g_hash_table_unref);
+  g_clear_object (&priv->wc);
+  g_clear_pointer (&priv->directory, g_free);
+
+  G_OBJECT_CLASS (totem_subtitle_cache_parent_class)->finalize (object);
+}
+
+static void
+totem_subtitle_cache_init (TotemSubtitleCache *self)
+{
+  self->priv = totem_subtitle_cache_get_instance_private (self);
+  self->priv->in_flight = g_hash_table_new (g_str_hash, g_str_equal);
+  self->priv->wc = grl_net_wc_new ();
+}
+
+static void
+totem_subtitle_cache_class_init (TotemSubtitleCacheClass *class)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (class);
+
+  object_class->finalize = totem_subtitle_cache_finalize;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#ifndef TOTEM_SUBTITLE_CACHE_H
+#define TOTEM_SUBTITLE_CACHE_H
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+#define TOTEM_TYPE_SUBTITLE_CACHE             (totem_subtitle_cache_get_type())
+
+#define TOTEM_SUBTITLE_CACHE(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), TOTEM_TYPE_SUBTITLE_CACHE, TotemSubtitleCache))
+#define TOTEM_SUBTITLE_CACHE_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), TOTEM_TYPE_SUBTITLE_CACHE, TotemSubtitleCacheClass))
+#define TOTEM_IS_SUBTITLE_CACHE(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), TOTEM_TYPE_SUBTITLE_CACHE))
+#define TOTEM_IS_SUBTITLE_CACHE_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), TOTEM_TYPE_SUBTITLE_CACHE))
+#define TOTEM_SUBTITLE_CACHE_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), TOTEM_TYPE_SUBTITLE_CACHE, TotemSubtitleCacheClass))
+
+typedef struct _TotemSubtitleCache        TotemSubtitleCache;
+typedef struct _TotemSubtitleCacheClass   TotemSubtitleCacheClass;
+typedef struct _TotemSubtitleCachePrivate TotemSubtitleCachePrivate;
+
+struct _TotemSubtitleCache
+{
+  GObject parent_instance;
+  TotemSubtitleCachePrivate *priv;
+};
+
+struct _TotemSubtitleCacheClass
+{
+  GObjectClass parent_class;
+};
+
+GType               totem_subtitle_cache_get_type           (void) G_GNUC_CONST;
+
+/* External */
+TotemSubtitleCache *totem_subtitle_cache_new (const gchar *directory);
+gchar *totem_subtitle_cache_lookup (TotemSubtitleCache *self,
+                                    const gchar        *hash,
+                                    const gchar        *language);
+void totem_subtitle_cache_fetch_async (TotemSubtitleCache  *self,
+                                       const gchar         *hash,
+                                       const gchar         *language,
+                                       const gchar         *url,
+                                       GCancellable        *cancellable,
+                                       GAsyncReadyCallback  callback,
+                                       gpointer             user_data);
+gchar *totem_subtitle_cache_fetch_finish (TotemSubtitleCache  *self,
+                                          GAsyncResult        *res,
+                                          GError             **error);
+
+G_END_DECLS
+
+#endif /* TOTEM_SUBTITLE_CACHE_H */
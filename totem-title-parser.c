@@ -0,0 +1,377 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+/* Fast path for the usual file names of tv shows and movies:
+ *   Show.Name.S01E02.Episode.Title.720p.mkv
+ *   Show Name - 1x02 - Episode Title.avi
+ *   Movie.Name.2010.1080p.BluRay.x264.mkv
+ * Anything else is left to grl-video-title-parsing. */
+
+#include "totem-title-parser.h"
+
+#include <string.h>
+
+/* Release tags: nothing after them is part of a title */
+static const gchar *junk_tokens[] = {
+  "480p", "576p", "720p", "1080p", "1080i", "2160p", "4k",
+  "hdtv", "pdtv", "dsr", "web", "webrip", "web-dl", "webdl", "hdrip",
+  "bluray", "bdrip", "brrip", "dvdrip", "dvdscr", "dvd",
+  "x264", "x265", "h264", "h265", "hevc", "xvid", "divx",
+  "aac", "ac3", "dts", "dd5", "proper", "repack", "internal",
+  "limited", "unrated", "extended", "multi", "subbed",
+  NULL
+};
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static inline gboolean
+is_space_like (gchar c)
+{
+  return c == '.' || c == '_' || c == ' ';
+}
+
+static inline gboolean
+is_boundary (const gchar *name,
+             gsize        len,
+             gsize        i)
+{
+  return i >= len || is_space_like (name[i]) || name[i] == '-' ||
+         name[i] == '[' || name[i] == ']' || name[i] == '(' || name[i] == ')';
+}
+
+static gboolean
+is_junk_token (const gchar *token,
+               gsize        len)
+{
+  guint i;
+
+  if (len == 0)
+    return FALSE;
+
+  if (token[0] == '[' || token[0] == '(')
+    return TRUE;
+
+  for (i = 0; junk_tokens[i] != NULL; i++) {
+    if (strlen (junk_tokens[i]) == len &&
+        g_ascii_strncasecmp (token, junk_tokens[i], len) == 0)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+/* Turns "Breaking.Bad." into "Breaking Bad", stopping at the first release
+ * tag when @stop_at_junk is set. Returns NULL if nothing is left. */
+static gchar *
+clean_name (const gchar *name,
+            gsize        len,
+            gboolean     stop_at_junk)
+{
+  GString *s;
+  gboolean sep;
+  gsize i;
+
+  s = g_string_sized_new (len);
+  sep = FALSE;
+  for (i = 0; i < len; i++) {
+    gchar c = name[i];
+
+    if (is_space_like (c)) {
+      sep = TRUE;
+      continue;
+    }
+
+    /* A dash between separators: "Show - 1x02 - Title" */
+    if (c == '-' && (i == 0 || is_space_like (name[i - 1])) &&
+        (i + 1 >= len || is_space_like (name[i + 1]))) {
+      sep = TRUE;
+      continue;
+    }
+
+    if (stop_at_junk && (i == 0 || sep)) {
+      gsize end = i;
+
+      while (end < len && !is_space_like (name[end]))
+        end++;
+      if (is_junk_token (name + i, end - i))
+        break;
+    }
+
+    if (sep && s->len > 0)
+      g_string_append_c (s, ' ');
+    sep = FALSE;
+    g_string_append_c (s, c);
+  }
+
+  /* Trailing dashes of "Show -" */
+  while (s->len > 0 && (s->str[s->len - 1] == '-' || s->str[s->len - 1] == ' '))
+    g_string_truncate (s, s->len - 1);
+
+  if (s->len == 0) {
+    g_string_free (s, TRUE);
+    return NULL;
+  }
+  return g_string_free (s, FALSE);
+}
+
+static gsize
+read_number (const gchar *name,
+             gsize        len,
+             gsize        i,
+             gsize        max_digits,
+             gint        *number)
+{
+  gsize start = i;
+  gint n = 0;
+
+  while (i < len && i - start < max_digits && g_ascii_isdigit (name[i])) {
+    n = n * 10 + (name[i] - '0');
+    i++;
+  }
+  *number = n;
+  return i - start;
+}
+
+/* S01E02, s1e2 */
+static gboolean
+match_sxxeyy (const gchar *name,
+              gsize        len,
+              gsize        i,
+              gint        *season,
+              gint        *episode,
+              gsize       *end)
+{
+  gsize n;
+
+  if (name[i] != 's' && name[i] != 'S')
+    return FALSE;
+  i++;
+
+  n = read_number (name, len, i, 2, season);
+  if (n == 0)
+    return FALSE;
+  i += n;
+
+  if (i >= len || (name[i] != 'e' && name[i] != 'E'))
+    return FALSE;
+  i++;
+
+  n = read_number (name, len, i, 3, episode);
+  if (n == 0)
+    return FALSE;
+  i += n;
+
+  /* Double episodes: S01E02E03 or S01E02-E03 */
+  if (i + 1 < len && (name[i] == 'e' || name[i] == 'E' || name[i] == '-') &&
+      (g_ascii_isdigit (name[i + 1]) || name[i + 1] == 'e' || name[i + 1] == 'E')) {
+    gint ignored;
+
+    i++;
+    if (name[i] == 'e' || name[i] == 'E')
+      i++;
+    i += read_number (name, len, i, 3, &ignored);
+  }
+
+  *end = i;
+  return is_boundary (name, len, i);
+}
+
+/* 1x02, 10x102 */
+static gboolean
+match_nxmm (const gchar *name,
+            gsize        len,
+            gsize        i,
+            gint        *season,
+            gint        *episode,
+            gsize       *end)
+{
+  gsize n;
+
+  n = read_number (name, len, i, 2, season);
+  if (n == 0)
+    return FALSE;
+  i += n;
+
+  if (i >= len || (name[i] != 'x' && name[i] != 'X'))
+    return FALSE;
+  i++;
+
+  n = read_number (name, len, i, 3, episode);
+  if (n < 2)
+    return FALSE;
+  i += n;
+
+  *end = i;
+  return is_boundary (name, len, i);
+}
+
+/* A 19xx or 20xx token */
+static gboolean
+match_year (const gchar *name,
+            gsize        len,
+            gsize        i,
+            gint        *year)
+{
+  if (i + 4 > len || !is_boundary (name, len, i + 4))
+    return FALSE;
+
+  if (!(name[i] == '1' && name[i + 1] == '9') &&
+      !(name[i] == '2' && name[i + 1] == '0'))
+    return FALSE;
+
+  return read_number (name, len, i, 4, year) == 4;
+}
+
+static const gchar *
+get_basename (const gchar *filename)
+{
+  const gchar *base;
+
+  base = strrchr (filename, '/');
+  return (base != NULL) ? base + 1 : filename;
+}
+
+/* Length of @name without its extension */
+static gsize
+strip_extension (const gchar *name)
+{
+  const gchar *dot;
+  gsize len, i;
+
+  len = strlen (name);
+  dot = strrchr (name, '.');
+  if (dot == NULL || dot == name || len - (dot - name) > 5)
+    return len;
+
+  for (i = 1; dot[i] != '\0'; i++) {
+    if (!g_ascii_isalnum (dot[i]))
+      return len;
+  }
+  return dot - name;
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+/* Parse the file name in @filename, a path is fine. Returns TRUE if @info
+ * was filled, as a tv show if @info->show is set or as a movie otherwise;
+ * totem_title_info_clear() must be called then. */
+gboolean
+totem_title_parser_parse (const gchar    *filename,
+                          TotemTitleInfo *info)
+{
+  const gchar *name;
+  gsize len, i, end;
+  gssize year_pos;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (info != NULL, FALSE);
+
+  memset (info, 0, sizeof (TotemTitleInfo));
+  name = get_basename (filename);
+  len = strip_extension (name);
+
+  year_pos = -1;
+  for (i = 1; i < len; i++) {
+    gint season, episode, year;
+
+    if (!is_boundary (name, len, i - 1))
+      continue;
+
+    if (match_sxxeyy (name, len, i, &season, &episode, &end) ||
+        match_nxmm (name, len, i, &season, &episode, &end)) {
+      info->show = clean_name (name, i, FALSE);
+      if (info->show == NULL)
+        continue;
+
+      info->season = season;
+      info->episode = episode;
+      info->title = clean_name (name + end, len - end, TRUE);
+      return TRUE;
+    }
+
+    /* The last one, as in "2001.A.Space.Odyssey.1968" */
+    if (match_year (name, len, i, &year)) {
+      info->year = year;
+      year_pos = i;
+    }
+  }
+
+  if (year_pos > 0) {
+    info->title = clean_name (name, year_pos, FALSE);
+    if (info->title != NULL)
+      return TRUE;
+  }
+
+  info->year = 0;
+  return FALSE;
+}
+
+void
+totem_title_info_clear (TotemTitleInfo *info)
+{
+  g_clear_pointer (&info->show, g_free);
+  g_clear_pointer (&info->title, g_free);
+}
+
+/* Synchronously set SHOW, SEASON, EPISODE and EPISODE_TITLE, or TITLE for
+ * movies, from the file name of @video. Returns FALSE when the file name
+ * has no known pattern. */
+gboolean
+totem_title_parser_parse_media (GrlMedia *video)
+{
+  TotemTitleInfo info;
+  const gchar *url;
+  gchar *filename;
+  gboolean found;
+
+  g_return_val_if_fail (GRL_IS_MEDIA (video), FALSE);
+
+  url = grl_media_get_url (video);
+  if (url == NULL)
+    return FALSE;
+
+  filename = g_uri_unescape_string (get_basename (url), NULL);
+  if (filename == NULL)
+    return FALSE;
+
+  found = totem_title_parser_parse (filename, &info);
+  g_free (filename);
+  if (!found)
+    return FALSE;
+
+  if (info.show != NULL) {
+    grl_media_set_show (video, info.show);
+    grl_media_set_season (video, info.season);
+    grl_media_set_episode (video, info.episode);
+    if (info.title != NULL)
+      grl_media_set_episode_title (video, info.title);
+  } else {
+    grl_media_set_title (video, info.title);
+  }
+
+  totem_title_info_clear (&info);
+  return TRUE;
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+#ifndef TOTEM_TITLE_PARSER_H
+#define TOTEM_TITLE_PARSER_H
+
+#include <grilo.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  gchar *show;
+  gchar *title;     /* Episode title for tv shows */
+  gint   season;
+  gint   episode;
+  gint   year;
+} TotemTitleInfo;
+
+/* External */
+gboolean totem_title_parser_parse (const gchar    *filename,
+                                   TotemTitleInfo *info);
+void totem_title_info_clear (TotemTitleInfo *info);
+gboolean totem_title_parser_parse_media (GrlMedia *video);
+
+G_END_DECLS
+
+#endif /* TOTEM_TITLE_PARSER_H */
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+/* Opt-in tracing in the Chrome trace event format. Times are monotonic, in
+ * microseconds. Spans are async events with an id of their own, spans of
+ * the same name run concurrently for many videos and would not nest on a
+ * single row. Events are written to the file as they come, in chunks. */
+
+#include "totem-trace.h"
+
+#include <errno.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* Events are buffered up to this size before they are written */
+#define CHUNK_SIZE (64 * 1024)
+
+typedef struct
+{
+  GMutex   lock;
+  gchar   *filename;
+  FILE    *file;
+  GString *events;
+  guint64  n_events;
+  guint64  n_spans;
+} Trace;
+
+/* -------------------------------------------------------------------------- *
+ * Internal / Helpers
+ * -------------------------------------------------------------------------- */
+
+static Trace *
+get_trace (void)
+{
+  static Trace *trace = NULL;
+  static gsize initialized = 0;
+
+  if (g_once_init_enter (&initialized)) {
+    const gchar *filename = g_getenv (TOTEM_TRACE_ENV);
+
+    if (filename != NULL && *filename != '\0') {
+      trace = g_new0 (Trace, 1);
+      g_mutex_init (&trace->lock);
+      trace->filename = g_strdup (filename);
+      trace->events = g_string_sized_new (CHUNK_SIZE);
+
+      /* The closing bracket of the array is optional in this format */
+      trace->file = g_fopen (filename, "w");
+      if (trace->file != NULL)
+        fputs ("[\n", trace->file);
+      else
+        g_warning ("Failed to open trace file %s: %s", filename, g_strerror (errno));
+    }
+    g_once_init_leave (&initialized, 1);
+  }
+
+  return trace;
+}
+
+static gchar *
+escape_json (const gchar *str)
+{
+  GString *escaped = g_string_sized_new (strlen (str));
+
+  for (; *str != '\0'; str++) {
+    if (*str == '"' || *str == '\\')
+      g_string_append_printf (escaped, "\\%c", *str);
+    else if ((guchar) *str < 0x20)
+      g_string_append_printf (escaped, "\\u%04x", (guchar) *str);
+    else
+      g_string_append_c (escaped, *str);
+  }
+  return g_string_free (escaped, FALSE);
+}
+
+/* Called with the lock held */
+static void
+write_events (Trace *trace)
+{
+  if (trace->file != NULL && trace->events->len > 0)
+    fwrite (trace->events->str, 1, trace->events->len, trace->file);
+  g_string_truncate (trace->events, 0);
+}
+
+/* Called with the lock held, before each event */
+static void
+append_separator (Trace *trace)
+{
+  if (trace->n_events++ > 0)
+    g_string_append (trace->events, ",\n");
+}
+
+/* Called with the lock held, after each event */
+static void
+event_appended (Trace *trace)
+{
+  if (trace->events->len >= CHUNK_SIZE)
+    write_events (trace);
+}
+
+/* -------------------------------------------------------------------------- *
+ * External
+ * -------------------------------------------------------------------------- */
+
+gboolean
+totem_trace_is_enabled (void)
+{
+  return get_trace () != NULL;
+}
+
+/* Record that @name ran from @start to @end, as g_get_monotonic_time().
+ * @detail, e.g. the url of the video, is optional. */
+void
+totem_trace_span (const gchar *name,
+                  gint64       start,
+                  gint64       end,
+                  const gchar *detail)
+{
+  Trace *trace = get_trace ();
+  gchar *escaped_name, *escaped_detail;
+  guint64 id;
+  gint pid;
+
+  if (trace == NULL)
+    return;
+
+  escaped_name = escape_json (name);
+  escaped_detail = escape_json (detail != NULL ? detail : "");
+  pid = (gint) getpid ();
+
+  g_mutex_lock (&trace->lock);
+  id = ++trace->n_spans;
+  append_separator (trace);
+  g_string_append_printf (trace->events,
+                          "{\"ph\":\"b\",\"cat\":\"totem\",\"name\":\"%s\",\"id\":\"0x%" G_GINT64_MODIFIER "x\","
+                          "\"pid\":%d,\"tid\":%d,\"ts\":%" G_GINT64_FORMAT ","
+                          "\"args\":{\"detail\":\"%s\"}}",
+                          escaped_name, id, pid, pid, start, escaped_detail);
+  append_separator (trace);
+  g_string_append_printf (trace->events,
+                          "{\"ph\":\"e\",\"cat\":\"totem\",\"name\":\"%s\",\"id\":\"0x%" G_GINT64_MODIFIER "x\","
+                          "\"pid\":%d,\"tid\":%d,\"ts\":%" G_GINT64_FORMAT "}",
+                          escaped_name, id, pid, pid, MAX (end, start));
+  event_appended (trace);
+  g_mutex_unlock (&trace->lock);
+
+  g_free (escaped_name);
+  g_free (escaped_detail);
+}
+
+/* Record the current @value of @name, e.g. the depth of a queue */
+void
+totem_trace_counter (const gchar *name,
+                     gint64       value)
+{
+  Trace *trace = get_trace ();
+  gchar *escaped;
+
+  if (trace == NULL)
+    return;
+
+  escaped = escape_json (name);
+
+  g_mutex_lock (&trace->lock);
+  append_separator (trace);
+  g_string_append_printf (trace->events,
+                          "{\"ph\":\"C\",\"name\":\"%s\",\"pid\":%d,"
+                          "\"ts\":%" G_GINT64_FORMAT ",\"args\":{\"value\":%" G_GINT64_FORMAT "}}",
+                          escaped, (gint) getpid (), g_get_monotonic_time (), value);
+  event_appended (trace);
+  g_mutex_unlock (&trace->lock);
+
+  g_free (escaped);
+}
+
+/* Write everything recorded so far */
+void
+totem_trace_flush (void)
+{
+  Trace *trace = get_trace ();
+
+  if (trace == NULL)
+    return;
+
+  g_mutex_lock (&trace->lock);
+  write_events (trace);
+  if (trace->file != NULL && fflush (trace->file) != 0)
+    g_warning ("Failed to write trace to %s: %s", trace->filename, g_strerror (errno));
+  g_mutex_unlock (&trace->lock);
+}
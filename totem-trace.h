@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2016 Victor Toso.
+ *
+ * Contact: Victor Toso <me@victortoso.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; version 2.1 of
+ * the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ *
+ */
+
+
+
+#ifndef TOTEM_TRACE_H
+#define TOTEM_TRACE_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Set to a file name to get a Chrome trace (chrome://tracing) of the
+ * pipeline, written as it goes; totem_trace_flush() writes the rest */
+#define TOTEM_TRACE_ENV "TOTEM_SERIES_TRACE"
+
+/* External */
+gboolean totem_trace_is_enabled (void);
+void totem_trace_span (const gchar *name,
+                       gint64       start,
+                       gint64       end,
+                       const gchar *detail);
+void totem_trace_counter (const gchar *name,
+                          gint64       value);
+void totem_trace_flush (void);
+
+G_END_DECLS
+
+#endif /* TOTEM_TRACE_H */